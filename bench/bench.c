@@ -0,0 +1,195 @@
+#include "runi_lisp.h"
+
+#include <fcntl.h>
+#include <libgen.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+struct workload {
+    const char *name;
+    char *source;
+    size_t len;
+    struct runi_context *ctx;
+    struct runi_object *env;
+    struct runi_object *forms;
+    struct runi_object *results;
+};
+
+static long min_time_ms = 200;
+
+static void discard_sink(void *data, const char *buf, size_t len) {
+    (void)data;
+    (void)buf;
+    (void)len;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+static void run_parse(struct workload *w) {
+    struct runi_reader reader;
+    runi_reader_init_buffer(&reader, w->source, w->len);
+    while (runi_read(w->ctx, &reader))
+        ;
+    runi_reader_close(&reader);
+}
+
+static void run_eval(struct workload *w) {
+    w->results = runi_nil;
+    for (struct runi_object *p = w->forms; p != runi_nil; p = p->cdr) {
+        struct runi_object *r = runi_eval(w->ctx, w->env, p->car);
+        w->results = runi_cons(w->ctx, r, w->results);
+        runi_arena_trim(w->ctx);
+    }
+}
+
+static void run_print(struct workload *w) {
+    for (struct runi_object *p = w->results; p != runi_nil; p = p->cdr) {
+        size_t len;
+        free(runi_print_to_string(w->ctx, p->car, &len));
+    }
+}
+
+static void measure(struct workload *w, const char *phase, void (*fn)(struct workload *)) {
+    struct runi_gc_stats before, after;
+    uint64_t iters = 0;
+    runi_gc_get_stats(w->ctx, &before);
+    uint64_t start = now_ns(), elapsed;
+    do {
+        fn(w);
+        iters++;
+        elapsed = now_ns() - start;
+    } while (elapsed < (uint64_t)min_time_ms * 1000000);
+    runi_gc_get_stats(w->ctx, &after);
+    printf("bench=%s vm=%d jit=%d phase=%s iters=%llu ns_per_op=%llu allocs_per_op=%llu bytes_per_op=%llu "
+           "collections=%zu peak_rss_kb=%ld\n",
+           w->name, w->ctx->vm_enabled, w->ctx->jit_enabled, phase, (unsigned long long)iters, (unsigned long long)(elapsed / iters),
+           (unsigned long long)((after.total_allocated_objects - before.total_allocated_objects) / iters),
+           (unsigned long long)((after.total_allocated_bytes - before.total_allocated_bytes) / iters),
+           after.collections - before.collections, peak_rss_kb());
+    fflush(stdout);
+}
+
+static int run_workload(struct workload *w, bool vm_enabled) {
+    w->ctx = runi_context_new(RUNI_DEFAULT_HEAP_SIZE);
+    if (!w->ctx) {
+        fprintf(stderr, "%s: Memory exhausted\n", w->name);
+        return 1;
+    }
+    w->ctx->vm_enabled = vm_enabled;
+    w->ctx->output = discard_sink;
+    w->env = runi_make_env(w->ctx, runi_nil, NULL);
+    w->forms = runi_nil;
+    w->results = runi_nil;
+    runi_gc_add_root(w->ctx, &w->env);
+    runi_gc_add_root(w->ctx, &w->forms);
+    runi_gc_add_root(w->ctx, &w->results);
+    runi_add_primitives(w->ctx, w->env);
+
+    struct runi_handler handler;
+    if (setjmp(handler.buf)) {
+        fprintf(stderr, "%s: %s\n", w->name, w->ctx->error);
+        return 1;
+    }
+    runi_push_handler(w->ctx, &handler);
+
+    struct runi_reader reader;
+    runi_reader_init_buffer(&reader, w->source, w->len);
+    struct runi_object *expr, *forms = runi_nil;
+    while ((expr = runi_read(w->ctx, &reader)))
+        w->forms = forms = runi_cons(w->ctx, expr, forms);
+    runi_reader_close(&reader);
+    w->forms = runi_nil;
+    for (; forms != runi_nil; forms = forms->cdr)
+        w->forms = runi_cons(w->ctx, forms->car, w->forms);
+
+    measure(w, "parse", run_parse);
+    measure(w, "eval", run_eval);
+    measure(w, "print", run_print);
+    runi_pop_handler(w->ctx, &handler);
+    runi_context_free(w->ctx);
+    return 0;
+}
+
+static bool load_source(struct workload *w, char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        return false;
+    }
+    w->len = st.st_size;
+    w->source = malloc(w->len + 1);
+    if (!w->source || read(fd, w->source, w->len) != (ssize_t)w->len) {
+        perror(path);
+        free(w->source);
+        close(fd);
+        return false;
+    }
+    close(fd);
+    char *name = strdup(basename(path));
+    char *dot = strrchr(name, '.');
+    if (dot)
+        *dot = '\0';
+    w->name = name;
+    return true;
+}
+
+static void usage(char *prog) {
+    fprintf(stderr, "usage: %s [-b] [-t min-time-ms] file ...\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    bool vm_enabled = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "bt:")) != -1) {
+        switch (opt) {
+        case 'b':
+            vm_enabled = true;
+            break;
+        case 't':
+            min_time_ms = atol(optarg);
+            if (min_time_ms <= 0)
+                usage(argv[0]);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind == argc)
+        usage(argv[0]);
+
+    int status = 0;
+    for (int i = optind; i < argc; i++) {
+        struct workload w = { 0 };
+        if (!load_source(&w, argv[i])) {
+            status = 1;
+            continue;
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0)
+            _exit(run_workload(&w, vm_enabled));
+        int child;
+        if (pid < 0 || waitpid(pid, &child, 0) < 0 || !WIFEXITED(child) || WEXITSTATUS(child) != 0) {
+            fprintf(stderr, "%s: benchmark failed\n", w.name);
+            status = 1;
+        }
+        free(w.source);
+        free((char *)w.name);
+    }
+    return status;
+}
@@ -0,0 +1,16 @@
+(defun iota (n acc)
+  (if (= n 0)
+      acc
+    (iota (- n 1) (cons n acc))))
+
+(defun reverse (l acc)
+  (if l
+      (reverse (cdr l) (cons (car l) acc))
+    acc))
+
+(defun churn (n l)
+  (if (= n 0)
+      l
+    (churn (- n 1) (reverse l ()))))
+
+(churn 50 (iota 1000 ()))
@@ -0,0 +1,18 @@
+(defmacro unless (c x)
+  (list 'if c () x))
+
+(defmacro when (c x)
+  (list 'if c x))
+
+(defmacro inc (x)
+  (list '+ x 1))
+
+(defmacro dec (x)
+  (list '- x 1))
+
+(defun count (n acc)
+  (if (= n 0)
+      acc
+    (count (dec n) (when (unless (< n 0) t) (inc acc)))))
+
+(count 5000 0)
@@ -0,0 +1,11 @@
+(defun fib (n)
+  (if (< n 2)
+      n
+    (+ (fib (- n 1)) (fib (- n 2)))))
+
+(defun iota (n acc)
+  (if (= n 0)
+      acc
+    (iota (- n 1) (cons n acc))))
+
+(preduce + 0 (pmap (lambda (n) (fib 15)) (iota 64 ())))
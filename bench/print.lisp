@@ -0,0 +1,11 @@
+(defun tree (n)
+  (if (= n 0)
+      'leaf
+    (cons (tree (- n 1)) (tree (- n 1)))))
+
+(defun iota (n acc)
+  (if (= n 0)
+      acc
+    (iota (- n 1) (cons n acc))))
+
+(list (tree 12) (iota 5000 ()) "a string to print")
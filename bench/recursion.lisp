@@ -0,0 +1,6 @@
+(defun depth (n)
+  (if (= n 0)
+      0
+    (+ 1 (depth (- n 1)))))
+
+(depth 2000)
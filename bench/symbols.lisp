@@ -0,0 +1,200 @@
+(quote (vize-0 zepomiha-1 hafefe-2 zevi-3 drzedr-4 rusazesa-5 mine-6 qukamize-7 fefe-8 hanenedr-9))
+(quote (neju-10 tozehato-11 pozene-12 mize-13 nekasa-14 ginemigi-15 safeha-16 juhagi-17 nezeju-18 vihaju-19))
+(quote (ruju-20 zehakafe-21 kadrdr-22 zedrpo-23 tolojuze-24 fene-25 topo-26 kapo-27 drzenelo-28 toka-29))
+(quote (zeze-30 vito-31 qupodrlo-32 satodrju-33 vifequ-34 lovigi-35 qumize-36 ruto-37 ruto-38 juharu-39))
+(quote (feloneze-40 drgigiru-41 vimiru-42 sarukavi-43 drlogiha-44 juqumi-45 lonemi-46 nelosa-47 kapo-48 rufe-49))
+(quote (rukahaha-50 kapomi-51 vipoka-52 vikadrne-53 fefe-54 podrqu-55 zeru-56 potoha-57 miha-58 fegize-59))
+(quote (gitokafe-60 juvifene-61 vito-62 mivimi-63 lokato-64 pogihavi-65 mimisadr-66 tofene-67 drjutodr-68 jupolo-69))
+(quote (haru-70 jupolo-71 loka-72 pojudrpo-73 saruka-74 miru-75 vipofeju-76 drsadrvi-77 drqugine-78 lopo-79))
+(quote (sapoto-80 nevi-81 pohane-82 nehami-83 vilotofe-84 miru-85 junemi-86 mivivine-87 juju-88 femidr-89))
+(quote (quze-90 haju-91 nedrloha-92 kalofe-93 vine-94 sazegi-95 sami-96 qujuto-97 girugipo-98 vipotosa-99))
+(quote (nezevilo-100 ruto-101 zenevi-102 kato-103 polozevi-104 quru-105 loze-106 kagi-107 zejuhavi-108 lojuruha-109))
+(quote (zeto-110 ponejufe-111 juqu-112 qupoqu-113 mikaqumi-114 sato-115 zehaju-116 fefekafe-117 vimipomi-118 tojugiha-119))
+(quote (drfeju-120 zefezedr-121 karu-122 ponejuju-123 lovijuka-124 rugi-125 satosafe-126 topo-127 loqu-128 mitoka-129))
+(quote (mika-130 giru-131 ququ-132 gigikaju-133 loka-134 gito-135 karunepo-136 kaloto-137 qusavi-138 zejugi-139))
+(quote (juto-140 sajuvize-141 salomi-142 fequjusa-143 giqu-144 pogiquka-145 drlo-146 vikakalo-147 misaqu-148 jufeferu-149))
+(quote (fetone-150 fefe-151 pone-152 drmipoze-153 pohavilo-154 hanefene-155 fequne-156 mipovi-157 tonequ-158 haloze-159))
+(quote (poporuqu-160 pozejumi-161 haju-162 kapofe-163 qururu-164 zesa-165 juto-166 fezefegi-167 neneju-168 nevigi-169))
+(quote (feha-170 zedr-171 pojugife-172 zehafe-173 poto-174 gifeha-175 saloju-176 runevi-177 kasa-178 nerunevi-179))
+(quote (tosato-180 juqu-181 kagi-182 nesane-183 visato-184 juqusa-185 drze-186 zevigi-187 vizedr-188 milotoha-189))
+(quote (pomika-190 kahajuju-191 vitomidr-192 karuqu-193 fepopogi-194 kalo-195 loloha-196 loru-197 zeha-198 zene-199))
+(quote (zene-200 vipomi-201 gife-202 hakapogi-203 nepomika-204 qulo-205 negimi-206 rurugimi-207 milovidr-208 vivirumi-209))
+(quote (vito-210 saqupoju-211 salo-212 fene-213 zehane-214 juhaqu-215 drvi-216 lorudrqu-217 gito-218 fekazeru-219))
+(quote (loto-220 nene-221 vitoqune-222 haviqu-223 tohamiha-224 nemiqu-225 kane-226 kakakalo-227 fesaju-228 kafesafe-229))
+(quote (zesa-230 gidrze-231 nejunequ-232 lotogidr-233 qufetoqu-234 kapolo-235 nedrfene-236 sapo-237 jumi-238 viqu-239))
+(quote (hadr-240 tohalo-241 rurusa-242 jurugi-243 misa-244 jujufeze-245 juru-246 juvidr-247 fevirune-248 feha-249))
+(quote (nesa-250 mipo-251 vidrgipo-252 tosa-253 rugivi-254 rufedrju-255 zene-256 feru-257 zedr-258 femisaha-259))
+(quote (haponene-260 zeru-261 qutokapo-262 juha-263 jutoka-264 tomizeru-265 lolomi-266 quhatopo-267 tosaru-268 zeze-269))
+(quote (toviposa-270 tofeze-271 fevize-272 drpo-273 zeneze-274 zeru-275 vihato-276 loha-277 zefedr-278 polo-279))
+(quote (sanedrha-280 nekadr-281 karu-282 qumife-283 gijupodr-284 drpoha-285 hadr-286 halo-287 loquhaha-288 hajukato-289))
+(quote (drmigi-290 pologife-291 jutoze-292 milogika-293 hadrgi-294 loju-295 drpo-296 fesato-297 miqudrto-298 lopo-299))
+(quote (vihasa-300 tominelo-301 tonevi-302 kaka-303 juru-304 karu-305 rulokato-306 tofetolo-307 milomivi-308 ruzekaru-309))
+(quote (mipone-310 drfejuru-311 zeha-312 drquha-313 femi-314 tozequ-315 lopofe-316 pokakaka-317 nelopoju-318 quju-319))
+(quote (rusa-320 lorufe-321 zequ-322 zetodrdr-323 sakalo-324 quzeto-325 tojufeha-326 lodrze-327 ruzemi-328 drlo-329))
+(quote (jutoju-330 nepomi-331 haloloju-332 nevi-333 drqu-334 feka-335 fenemi-336 miminelo-337 ruquha-338 quhadr-339))
+(quote (saha-340 saviru-341 fedrne-342 halomimi-343 nezequvi-344 lomifefe-345 vize-346 drto-347 qurupo-348 gife-349))
+(quote (pohatosa-350 neneka-351 nesasaka-352 vika-353 havi-354 mihavi-355 gihaneha-356 fetokaqu-357 tone-358 drju-359))
+(quote (haviha-360 gitokaju-361 hahazepo-362 givife-363 tokami-364 vitoka-365 drgife-366 fejuvi-367 zedrjune-368 zezezedr-369))
+(quote (vigi-370 safe-371 povize-372 losaju-373 tosa-374 zedr-375 sasa-376 nedr-377 migi-378 visaze-379))
+(quote (kalosagi-380 kadrtolo-381 ruqu-382 pone-383 zezeju-384 vigisane-385 vipo-386 poka-387 kafe-388 tomitopo-389))
+(quote (zeru-390 rupo-391 sakadrqu-392 polosa-393 torufe-394 juru-395 sasaloqu-396 saneha-397 jumizepo-398 lofe-399))
+(quote (vidrvi-400 gigijuru-401 nehapo-402 rujusa-403 logiruru-404 lojunemi-405 zeka-406 vijuha-407 viruruha-408 drhalo-409))
+(quote (gife-410 gitoto-411 tosavife-412 drne-413 hane-414 giha-415 zeto-416 gizesato-417 pogigiju-418 nelojuto-419))
+(quote (zeha-420 hagi-421 ponezesa-422 tosazeka-423 gihamimi-424 vipodr-425 zequlopo-426 rupomika-427 femiju-428 kakazepo-429))
+(quote (sanevi-430 kajuneze-431 pofe-432 ruze-433 vijufe-434 zekato-435 poha-436 zesalogi-437 jujuha-438 hajuru-439))
+(quote (zesahaqu-440 kapovilo-441 kapolo-442 qunekaze-443 kagiha-444 ququ-445 halo-446 nepo-447 haqufe-448 mipofeto-449))
+(quote (gizefelo-450 pototo-451 drne-452 tosa-453 qufedrru-454 zequtodr-455 fezejulo-456 rudrru-457 nesa-458 tofe-459))
+(quote (kagi-460 fesa-461 kanetoka-462 girumiha-463 judrdr-464 poquzeru-465 polo-466 mivi-467 tomidrsa-468 fequruru-469))
+(quote (lopoqu-470 posasa-471 neru-472 nequtomi-473 zeka-474 nehafe-475 zeruha-476 drqupo-477 zelovika-478 junequlo-479))
+(quote (pone-480 vimilogi-481 losapo-482 sadr-483 lojuru-484 quka-485 qujuqu-486 negiloka-487 juto-488 rugitoha-489))
+(quote (runegilo-490 hagi-491 logi-492 losaze-493 zeto-494 vigito-495 judr-496 kaqudrha-497 sahato-498 sasavi-499))
+(quote (mikaloju-500 ruqu-501 sagimi-502 drmi-503 lodrfe-504 vimi-505 quloze-506 povidrka-507 visapo-508 satokaze-509))
+(quote (saloloru-510 visasa-511 sami-512 zeneju-513 vigigi-514 viloto-515 miporugi-516 fene-517 zenegi-518 sapoqu-519))
+(quote (ruhasa-520 jujuqu-521 saqu-522 juze-523 qudr-524 gizeha-525 sami-526 drpoto-527 jumika-528 lolotoze-529))
+(quote (zerusasa-530 kaqu-531 kavi-532 gimife-533 visa-534 fekaposa-535 juloneto-536 jufene-537 zequgika-538 gisaqu-539))
+(quote (ruha-540 neru-541 rutoju-542 drlo-543 fejufeha-544 gigi-545 feka-546 sasa-547 fevi-548 giqu-549))
+(quote (drrupo-550 fepone-551 gifegi-552 kaha-553 nerupo-554 drgi-555 tosane-556 saloquze-557 hatofe-558 lohaneha-559))
+(quote (kavi-560 toju-561 zelo-562 nezezeto-563 lovito-564 karufe-565 fefefequ-566 logiqu-567 fevi-568 zesajupo-569))
+(quote (givi-570 fene-571 giruqu-572 junejuha-573 rutopo-574 qune-575 gidrzequ-576 ginegi-577 kapoto-578 loloha-579))
+(quote (neju-580 safevika-581 lojugilo-582 poto-583 pohalo-584 lorukato-585 tomifegi-586 nehaka-587 nekaquze-588 pofe-589))
+(quote (gijusa-590 zene-591 rufe-592 poquviju-593 sanefelo-594 fepoka-595 gimilogi-596 zepopo-597 tojudrze-598 lojudrvi-599))
+(quote (zeruqu-600 virujudr-601 mipogi-602 sapopo-603 visa-604 fehaze-605 drzequru-606 logiha-607 kaka-608 lonesaka-609))
+(quote (gidr-610 loqu-611 haka-612 quviqu-613 juru-614 fedrvi-615 fenehagi-616 mimine-617 qusami-618 rulodr-619))
+(quote (zeneviru-620 nekato-621 vidrze-622 poto-623 mihaka-624 zene-625 rufe-626 miqu-627 hajururu-628 logivi-629))
+(quote (zeloru-630 vigikagi-631 jufe-632 gizeze-633 kafevi-634 quka-635 nelo-636 kadr-637 judr-638 zeto-639))
+(quote (mifezequ-640 fegi-641 savi-642 lotomi-643 sasadrto-644 sapoju-645 quze-646 nedrgi-647 haju-648 neze-649))
+(quote (qugi-650 nevi-651 lofe-652 tofe-653 qusa-654 rusa-655 todrzedr-656 qumi-657 zedrfe-658 netopolo-659))
+(quote (juloka-660 judrqugi-661 vilovife-662 mimiru-663 giginesa-664 zezehaha-665 zejuto-666 zedrsa-667 lorupofe-668 loze-669))
+(quote (tomi-670 zerupo-671 hazemilo-672 sadrdr-673 gisafe-674 qusa-675 vimiju-676 toqu-677 rutoju-678 qumi-679))
+(quote (lorudr-680 drpomi-681 tovisaha-682 ruhapo-683 drmidr-684 pone-685 drkalodr-686 femidrqu-687 vifehavi-688 gidr-689))
+(quote (kakahavi-690 loferu-691 neharuru-692 juvimi-693 sagiqu-694 ponesa-695 gimivi-696 lojuru-697 fepovi-698 julo-699))
+(quote (visagi-700 tojusa-701 rumi-702 pogiloru-703 qujuneha-704 gitodrqu-705 tofe-706 lorusa-707 tojulo-708 zegizeka-709))
+(quote (losafe-710 jujuhato-711 gidrfemi-712 drdrferu-713 qumisami-714 nequ-715 zekami-716 zene-717 haqumiqu-718 fetorudr-719))
+(quote (rulodr-720 nenegika-721 zezemiju-722 rufeferu-723 drhasa-724 qunemigi-725 poruhagi-726 viruquha-727 juzeze-728 rufe-729))
+(quote (lojugi-730 misakaha-731 gigijupo-732 gipo-733 vijuloka-734 sajusa-735 zesaju-736 lomineze-737 zeze-738 lodrru-739))
+(quote (gitotogi-740 topoju-741 drto-742 lolohapo-743 sajulo-744 hajusa-745 sato-746 drharu-747 fequ-748 mineze-749))
+(quote (haruka-750 vikadr-751 tozene-752 logine-753 drdrha-754 topo-755 zejudr-756 rugisa-757 halolo-758 zedrquka-759))
+(quote (lodr-760 quka-761 vitofesa-762 zepogimi-763 poru-764 mitodrdr-765 nenelo-766 ququkavi-767 vijumi-768 drka-769))
+(quote (vigirune-770 gidrpoto-771 vito-772 jumika-773 poneha-774 drtodrze-775 rupoka-776 kamisaka-777 milojuru-778 jufevi-779))
+(quote (julogi-780 neka-781 hami-782 savipo-783 vimiloto-784 vito-785 miqupo-786 haru-787 gimivi-788 karudrqu-789))
+(quote (poju-790 quruviru-791 mika-792 mize-793 vipofe-794 rudr-795 jumimidr-796 pomipofe-797 visa-798 miqu-799))
+(quote (hadrsa-800 rugi-801 haququne-802 qufelo-803 nekadr-804 mife-805 sami-806 loqudrze-807 gihaporu-808 fejulopo-809))
+(quote (nemifene-810 nemimi-811 satoha-812 satovine-813 hagihapo-814 satomi-815 gimiha-816 jujuqugi-817 lojujuvi-818 poloka-819))
+(quote (lohakafe-820 popo-821 junepo-822 drdrvi-823 vife-824 savivi-825 giquhaka-826 kajuloha-827 loquruqu-828 kalo-829))
+(quote (qukasaha-830 kadrto-831 givigi-832 hato-833 drqu-834 jurudr-835 miru-836 poruze-837 quvi-838 mifezeha-839))
+(quote (satopomi-840 qukafe-841 jufegi-842 mihaha-843 hadr-844 ruzemipo-845 gigihagi-846 vimine-847 rururune-848 lohajulo-849))
+(quote (migifevi-850 zejujuju-851 nedrquka-852 drju-853 fevimivi-854 kagivi-855 gikagivi-856 toloka-857 mivivi-858 nedr-859))
+(quote (zequdr-860 gitoze-861 drjuzesa-862 polokaqu-863 tone-864 rugijuru-865 neka-866 saha-867 saha-868 tomidrju-869))
+(quote (ferukaqu-870 vizemi-871 zemi-872 hagi-873 lojufesa-874 vilodr-875 miru-876 giloto-877 juhaviru-878 fefe-879))
+(quote (hahafe-880 sane-881 judrze-882 gimine-883 gifequ-884 qulosaju-885 zelo-886 quhalone-887 zesalo-888 misa-889))
+(quote (vimi-890 gife-891 girutoze-892 neto-893 girulodr-894 todrtopo-895 qusa-896 miqupone-897 midrka-898 haru-899))
+(quote (drmi-900 pozetoto-901 fepotogi-902 rusajuto-903 sazekaha-904 drkavi-905 sajusa-906 kajulo-907 zetotomi-908 fetovi-909))
+(quote (mimivivi-910 nefegi-911 hakakaju-912 drjumi-913 ponegi-914 negivi-915 zetoqu-916 poquka-917 loru-918 toru-919))
+(quote (tofe-920 mirupo-921 kaju-922 gigi-923 gilovilo-924 qune-925 fetovidr-926 toquhalo-927 tojuru-928 nedrha-929))
+(quote (samisane-930 zelo-931 nemi-932 juqulo-933 nequvi-934 nelohane-935 fegi-936 pohajuqu-937 lojuze-938 giloto-939))
+(quote (tone-940 mife-941 neju-942 drdrrupo-943 toju-944 mizeka-945 miferu-946 midrloru-947 kahajuka-948 rukapoju-949))
+(quote (vifeto-950 havi-951 lomivi-952 loqudrqu-953 giqu-954 jujuhafe-955 saru-956 qufe-957 gize-958 lomi-959))
+(quote (qusa-960 migiju-961 jupolofe-962 kamilolo-963 nejuto-964 hakaka-965 drvilo-966 fevigilo-967 vidrvi-968 lomizeto-969))
+(quote (poru-970 saru-971 sanetoto-972 juruneto-973 judrsa-974 nekazepo-975 rurupoze-976 gidr-977 feruviqu-978 nequvi-979))
+(quote (jusakaru-980 satozene-981 jutomi-982 loju-983 pohaposa-984 gihane-985 ruzetoka-986 sajuru-987 hasa-988 fegine-989))
+(quote (tosadr-990 kato-991 jufe-992 mihagilo-993 qujuhaqu-994 juqu-995 saposa-996 haneka-997 ruju-998 poju-999))
+(quote (nezelo-1000 feka-1001 ruha-1002 drto-1003 topo-1004 totoju-1005 midr-1006 girumipo-1007 hapodrru-1008 togiju-1009))
+(quote (sahaju-1010 tone-1011 jugi-1012 miqumi-1013 havisalo-1014 lokavigi-1015 gigi-1016 gihaqufe-1017 feneru-1018 qumize-1019))
+(quote (vito-1020 zefejusa-1021 sanedr-1022 zefe-1023 june-1024 tozeze-1025 kalodrto-1026 rururu-1027 nekasavi-1028 runedr-1029))
+(quote (poto-1030 zehakapo-1031 poto-1032 mimipodr-1033 femi-1034 rugilopo-1035 pomiquto-1036 vine-1037 tohasa-1038 mito-1039))
+(quote (zequ-1040 drneha-1041 neru-1042 kadr-1043 nevikasa-1044 juposafe-1045 kazedrqu-1046 jupogi-1047 rudrmidr-1048 giqu-1049))
+(quote (rune-1050 fegiru-1051 rukalo-1052 vifegi-1053 hazeju-1054 giloqune-1055 rupogife-1056 toka-1057 torusaju-1058 saneze-1059))
+(quote (mijuka-1060 salo-1061 sapoqu-1062 zerumi-1063 sasaze-1064 kajusa-1065 milo-1066 fedr-1067 vipodr-1068 gilozeto-1069))
+(quote (rupo-1070 vize-1071 salo-1072 rudrgi-1073 halo-1074 poze-1075 pohasa-1076 nefesa-1077 lojugife-1078 jugi-1079))
+(quote (toto-1080 sadrfefe-1081 drzegi-1082 zetoru-1083 mihato-1084 ruqulo-1085 fezefe-1086 pohaqu-1087 rugiloka-1088 lozene-1089))
+(quote (tolo-1090 girupoze-1091 povilo-1092 pogi-1093 drjuze-1094 pomivi-1095 qufequ-1096 vimika-1097 rumihafe-1098 poqufe-1099))
+(quote (vizeviru-1100 nejurulo-1101 toha-1102 lokane-1103 gipo-1104 zeha-1105 nequpo-1106 toneto-1107 nemiruvi-1108 pomizeha-1109))
+(quote (kadr-1110 feze-1111 drkahapo-1112 feha-1113 nevize-1114 drquvi-1115 virunelo-1116 jusato-1117 zeka-1118 podr-1119))
+(quote (lojulo-1120 kaqu-1121 hasatolo-1122 mize-1123 nenezequ-1124 fevitone-1125 jukafe-1126 poqudrne-1127 nemi-1128 gilo-1129))
+(quote (kadrnedr-1130 lovidrto-1131 tozegi-1132 gisane-1133 rulohaze-1134 zepotopo-1135 poze-1136 mijudr-1137 kane-1138 kaloju-1139))
+(quote (poha-1140 kakaka-1141 hasagipo-1142 saloru-1143 fepotofe-1144 totosa-1145 vigi-1146 gito-1147 juferuze-1148 sato-1149))
+(quote (jufeloqu-1150 mimiru-1151 katoqusa-1152 fejugisa-1153 feto-1154 drjuqu-1155 sane-1156 loloneju-1157 qumizelo-1158 tosa-1159))
+(quote (feju-1160 kalo-1161 drlone-1162 miru-1163 misa-1164 fequdr-1165 jumimiju-1166 qulo-1167 drju-1168 samigito-1169))
+(quote (toqusato-1170 lonekafe-1171 karuto-1172 rufe-1173 hasazequ-1174 drzelone-1175 vimi-1176 qurugika-1177 rufekaka-1178 lovikato-1179))
+(quote (losasaze-1180 gidrdrqu-1181 posaha-1182 samitomi-1183 zerumi-1184 drsafefe-1185 qujuvito-1186 givizedr-1187 haka-1188 pomitoze-1189))
+(quote (kaviqufe-1190 qutomi-1191 kaha-1192 katomine-1193 fegiju-1194 gine-1195 qudrqudr-1196 nesami-1197 hadrto-1198 toka-1199))
+(quote (vimi-1200 fekafevi-1201 mine-1202 vize-1203 sane-1204 miju-1205 sahazepo-1206 drfemipo-1207 kadrze-1208 poruvilo-1209))
+(quote (qupodr-1210 gizejumi-1211 rupoka-1212 drhaqulo-1213 giloze-1214 ruhapoka-1215 zefejugi-1216 vifenegi-1217 jujugi-1218 drzegi-1219))
+(quote (sasa-1220 ponefe-1221 qukaka-1222 rusane-1223 mivine-1224 miju-1225 fene-1226 lovi-1227 satoju-1228 vife-1229))
+(quote (zedrmiha-1230 gidr-1231 feto-1232 pone-1233 gijuru-1234 mivinefe-1235 kasaqu-1236 halofe-1237 posarulo-1238 hasa-1239))
+(quote (posakane-1240 sane-1241 miloha-1242 sajujuto-1243 drne-1244 hadrqusa-1245 fegi-1246 giqu-1247 gigi-1248 gisagivi-1249))
+(quote (pohatodr-1250 vilo-1251 popo-1252 zenenemi-1253 sasaru-1254 miruka-1255 pogihaqu-1256 zefemine-1257 qupodr-1258 femi-1259))
+(quote (neze-1260 julogipo-1261 pokadrlo-1262 todrzeka-1263 fegiqupo-1264 fejumipo-1265 zequfesa-1266 feju-1267 quvilo-1268 quka-1269))
+(quote (drdrne-1270 hadr-1271 kadr-1272 harudrha-1273 poqu-1274 gisa-1275 giha-1276 gisato-1277 nedrqu-1278 fejufe-1279))
+(quote (jufetoha-1280 zeze-1281 drfelodr-1282 haruquru-1283 povi-1284 zevito-1285 qudrsaha-1286 zedrsaha-1287 vihagito-1288 lopone-1289))
+(quote (juru-1290 gimivi-1291 gimi-1292 ruhato-1293 kahazequ-1294 giqutomi-1295 haqugi-1296 zedrju-1297 mivize-1298 viru-1299))
+(quote (nequze-1300 drsa-1301 totozeha-1302 judrfe-1303 zequ-1304 kavirupo-1305 hahaju-1306 zevihaqu-1307 poporu-1308 loruto-1309))
+(quote (gimi-1310 drto-1311 podrpoto-1312 juzeloru-1313 lonefe-1314 zekaha-1315 pomifeju-1316 femifene-1317 torupoju-1318 gihazeka-1319))
+(quote (safe-1320 zeze-1321 julolofe-1322 zene-1323 tofe-1324 sasaqu-1325 sarusa-1326 safequ-1327 fepopo-1328 fequmife-1329))
+(quote (fekaru-1330 drjuze-1331 kasaka-1332 polosa-1333 rusane-1334 harumi-1335 losaka-1336 kaha-1337 vinemimi-1338 sakaha-1339))
+(quote (fefemi-1340 pokatoka-1341 qumigi-1342 safevipo-1343 pomirusa-1344 jutone-1345 jugi-1346 tojudrdr-1347 tomisa-1348 pogi-1349))
+(quote (mine-1350 ruginevi-1351 ruhasa-1352 haneruka-1353 vika-1354 torulo-1355 gimiha-1356 feruru-1357 juha-1358 nezejumi-1359))
+(quote (mikapo-1360 havipo-1361 qunevize-1362 gidr-1363 loqu-1364 drto-1365 drfe-1366 povihadr-1367 sarumi-1368 zequka-1369))
+(quote (qusa-1370 gigito-1371 losagisa-1372 kaju-1373 vizedr-1374 kavize-1375 kanepopo-1376 lomitosa-1377 tonequ-1378 haru-1379))
+(quote (loqu-1380 jumi-1381 fezelovi-1382 vifevi-1383 zefekaka-1384 loju-1385 drdr-1386 sakaneze-1387 zeju-1388 toqufeha-1389))
+(quote (toquvi-1390 lovisane-1391 qusa-1392 rurutoqu-1393 pojunesa-1394 jutozequ-1395 giruvi-1396 fezegito-1397 rufevife-1398 poto-1399))
+(quote (feju-1400 poju-1401 vifenepo-1402 toneto-1403 miha-1404 drnesalo-1405 kasagipo-1406 fepolo-1407 girudr-1408 juju-1409))
+(quote (fefe-1410 mivipoka-1411 fefe-1412 jukalo-1413 fehaze-1414 juju-1415 mipofe-1416 rupo-1417 drqu-1418 quru-1419))
+(quote (gika-1420 hafevigi-1421 katogine-1422 gizefe-1423 femi-1424 nelo-1425 junegi-1426 kamipodr-1427 drgi-1428 sapopo-1429))
+(quote (kafeha-1430 haporuru-1431 hadrkaru-1432 viqu-1433 migidr-1434 viha-1435 logi-1436 drdr-1437 zenegi-1438 quhatopo-1439))
+(quote (tomi-1440 mitovi-1441 poha-1442 juneto-1443 jusagito-1444 havi-1445 vizeka-1446 toqulo-1447 togipo-1448 zelokavi-1449))
+(quote (fegividr-1450 juha-1451 drfe-1452 lotoviha-1453 drgi-1454 midr-1455 vigi-1456 hadr-1457 feporuka-1458 juqumi-1459))
+(quote (hagikagi-1460 pomisa-1461 tominene-1462 karufeju-1463 sasa-1464 quzeto-1465 drponegi-1466 jufequ-1467 zemijuze-1468 safe-1469))
+(quote (migi-1470 ruzejuju-1471 halovife-1472 fequzeha-1473 zevilo-1474 sapoqu-1475 nevi-1476 poju-1477 nesazeto-1478 rusaqu-1479))
+(quote (qukasa-1480 tovika-1481 rumiqu-1482 drlogi-1483 qutosa-1484 mirupo-1485 rumiferu-1486 ferumigi-1487 mijulomi-1488 sanegiru-1489))
+(quote (qutoze-1490 drne-1491 rurufesa-1492 juqu-1493 pologi-1494 drju-1495 loru-1496 quporumi-1497 viqu-1498 jujuka-1499))
+(quote (loha-1500 kazevipo-1501 tosasalo-1502 drzegi-1503 femi-1504 nepo-1505 viruha-1506 saqu-1507 gilomi-1508 feha-1509))
+(quote (hasasa-1510 zequru-1511 poru-1512 mijufefe-1513 jujune-1514 togi-1515 hazerumi-1516 hakasa-1517 tonerulo-1518 tovi-1519))
+(quote (poviru-1520 fezehapo-1521 haka-1522 lohadr-1523 tolokalo-1524 fehane-1525 losa-1526 loka-1527 haporuha-1528 qulodrne-1529))
+(quote (lorufeze-1530 ferufe-1531 gife-1532 judr-1533 judr-1534 miju-1535 gikamiru-1536 rurugiha-1537 nehaze-1538 zepogito-1539))
+(quote (jugife-1540 zene-1541 qufeju-1542 nehadrju-1543 pokaquvi-1544 ponesane-1545 drkapoto-1546 qumika-1547 viru-1548 todr-1549))
+(quote (zetovipo-1550 posa-1551 karu-1552 lone-1553 ruze-1554 zekamito-1555 posazeha-1556 lotoqu-1557 zelo-1558 feka-1559))
+(quote (nelokaju-1560 zene-1561 gipohato-1562 qulogi-1563 halolo-1564 rusa-1565 quju-1566 minetosa-1567 kahadr-1568 zesa-1569))
+(quote (zepoze-1570 qudrju-1571 loka-1572 topolo-1573 loviloju-1574 porudr-1575 viquju-1576 ginene-1577 viqunelo-1578 drsaquju-1579))
+(quote (zenevivi-1580 saruru-1581 gisa-1582 gisapo-1583 vize-1584 haka-1585 todr-1586 loha-1587 rufegi-1588 toha-1589))
+(quote (jurudr-1590 jugipo-1591 zelopodr-1592 topo-1593 vihaqu-1594 neto-1595 ruha-1596 ququto-1597 poloneju-1598 drtovi-1599))
+(quote (kadrpovi-1600 popo-1601 nehakaze-1602 gidrlo-1603 fenegivi-1604 fehaha-1605 logife-1606 lokadrju-1607 safeposa-1608 milo-1609))
+(quote (vize-1610 drzelopo-1611 havidrpo-1612 kanezepo-1613 lozevi-1614 miferu-1615 popo-1616 netomidr-1617 netozepo-1618 fedrze-1619))
+(quote (kanemi-1620 kahadrpo-1621 qujumito-1622 tohakaqu-1623 mimifegi-1624 neze-1625 june-1626 lodrdrdr-1627 toka-1628 vidr-1629))
+(quote (feze-1630 kafedr-1631 ruqu-1632 kaququne-1633 lodr-1634 tosa-1635 mizeha-1636 drmiqu-1637 poto-1638 zesa-1639))
+(quote (giha-1640 rutoru-1641 jupo-1642 haruze-1643 juju-1644 drfe-1645 tozemi-1646 zedr-1647 loto-1648 rudr-1649))
+(quote (juha-1650 vitone-1651 mikalogi-1652 giru-1653 ruqudrka-1654 drmiruqu-1655 drtolo-1656 neha-1657 viharuvi-1658 drqu-1659))
+(quote (totoka-1660 giru-1661 drzequgi-1662 sasami-1663 savijuto-1664 samize-1665 fegivine-1666 quzetomi-1667 ginepodr-1668 fepofelo-1669))
+(quote (rutoru-1670 fequ-1671 quvi-1672 zequdrha-1673 toqune-1674 pozedrmi-1675 harumiju-1676 lone-1677 loqu-1678 rupomito-1679))
+(quote (negiviju-1680 qupokadr-1681 feha-1682 harupoka-1683 zejuju-1684 june-1685 lofeju-1686 vimigi-1687 giha-1688 poquvi-1689))
+(quote (juzesaru-1690 tokahagi-1691 ruvifegi-1692 mivivi-1693 popo-1694 satoloju-1695 qumiru-1696 sajumito-1697 netosaze-1698 losaze-1699))
+(quote (lohane-1700 hatone-1701 zegiloto-1702 mizesa-1703 kaviha-1704 rulo-1705 nefemi-1706 tonemilo-1707 fedr-1708 lokatoha-1709))
+(quote (sasaze-1710 rulo-1711 nehatone-1712 lodrmika-1713 femi-1714 drsaru-1715 rune-1716 gidrju-1717 rugiha-1718 mine-1719))
+(quote (nenenene-1720 gidrpo-1721 zegidrmi-1722 nelomi-1723 fegizelo-1724 todrha-1725 jusa-1726 mizedrpo-1727 juvisadr-1728 sagiqusa-1729))
+(quote (vidr-1730 fehapo-1731 minemi-1732 lovipopo-1733 gilo-1734 gizefe-1735 podrpone-1736 kapotopo-1737 saviha-1738 toferu-1739))
+(quote (vivitodr-1740 vidr-1741 saqu-1742 qukalogi-1743 negiqumi-1744 zetofe-1745 gilo-1746 gisa-1747 haquha-1748 kafegilo-1749))
+(quote (vidr-1750 gihavito-1751 girugi-1752 sato-1753 fenemi-1754 juto-1755 hazedr-1756 jutodrvi-1757 kalo-1758 sasavi-1759))
+(quote (nejuqu-1760 fepoqu-1761 vifeporu-1762 vilodrju-1763 juze-1764 sakaloru-1765 povi-1766 qulo-1767 safe-1768 mipokalo-1769))
+(quote (fezesaju-1770 hafekapo-1771 kajudr-1772 runekafe-1773 midr-1774 haha-1775 drdrzelo-1776 migihaqu-1777 zeha-1778 haqu-1779))
+(quote (fevife-1780 ruqugi-1781 zegidrfe-1782 rumipopo-1783 katodr-1784 ququ-1785 rurujusa-1786 fegi-1787 gifegilo-1788 gimisa-1789))
+(quote (ruvi-1790 mipovi-1791 mifeha-1792 zenedr-1793 drfe-1794 jumi-1795 mika-1796 qufe-1797 ququpo-1798 qupo-1799))
+(quote (drmi-1800 neha-1801 sasaze-1802 polo-1803 drkajupo-1804 loka-1805 felo-1806 vilo-1807 gilo-1808 gidrne-1809))
+(quote (giloqu-1810 quzequ-1811 drgi-1812 fevivi-1813 vineha-1814 rumi-1815 gikami-1816 juneju-1817 fevito-1818 giju-1819))
+(quote (lopohagi-1820 hafe-1821 fekaruha-1822 juka-1823 gize-1824 zemi-1825 hahaqu-1826 rupoloru-1827 lokaka-1828 zelo-1829))
+(quote (drlohaqu-1830 kajuvi-1831 tonene-1832 drmi-1833 zeporupo-1834 rusadrvi-1835 miju-1836 giha-1837 visa-1838 mimisaha-1839))
+(quote (giha-1840 kaju-1841 qufe-1842 podrvi-1843 jufequ-1844 minequ-1845 todrto-1846 drgi-1847 mife-1848 kadrdrdr-1849))
+(quote (nejudr-1850 virumiqu-1851 kakadr-1852 nehasa-1853 miqusa-1854 qujugiju-1855 zesaha-1856 qutosa-1857 ruze-1858 nepo-1859))
+(quote (qufepoze-1860 karugilo-1861 kavimi-1862 zejuqugi-1863 runesa-1864 hadrnedr-1865 zemi-1866 fevine-1867 ruka-1868 kamine-1869))
+(quote (toqusa-1870 rupo-1871 haharuju-1872 junegi-1873 poka-1874 ginemito-1875 qudrju-1876 zeze-1877 feju-1878 toqupo-1879))
+(quote (losa-1880 zefe-1881 fegiqu-1882 ponetogi-1883 katoqu-1884 zevivi-1885 zehamika-1886 lopo-1887 sasapoto-1888 juze-1889))
+(quote (judrru-1890 mitodrru-1891 fetodrpo-1892 zeto-1893 sagi-1894 femifeju-1895 ponepoha-1896 popo-1897 hamidrpo-1898 posa-1899))
+(quote (mito-1900 rulofe-1901 qupo-1902 mivi-1903 drdr-1904 misaju-1905 kafehaju-1906 drruha-1907 nequ-1908 juvimigi-1909))
+(quote (gitopo-1910 gine-1911 nequ-1912 zehapoju-1913 tozevi-1914 juvipolo-1915 femine-1916 mineju-1917 jufeporu-1918 ruha-1919))
+(quote (drlo-1920 lomi-1921 rumitosa-1922 drpogine-1923 gigi-1924 jupomivi-1925 saru-1926 hamigi-1927 neruhavi-1928 fetopo-1929))
+(quote (miqu-1930 drjuqu-1931 zekaze-1932 felogi-1933 rutogi-1934 gikaju-1935 vijuvize-1936 milofeto-1937 drze-1938 neruzeto-1939))
+(quote (tomi-1940 kamimiru-1941 kakato-1942 quzenegi-1943 hatoka-1944 drruto-1945 hasaka-1946 drloru-1947 tolosa-1948 drlotopo-1949))
+(quote (gifejuvi-1950 gitoqugi-1951 saruqune-1952 sasa-1953 nezehaha-1954 poqulo-1955 fezevi-1956 nemirumi-1957 runeto-1958 drqu-1959))
+(quote (fesa-1960 toharuju-1961 zekapofe-1962 juru-1963 hamihagi-1964 givi-1965 loze-1966 gilozeto-1967 zefedrdr-1968 kakaru-1969))
+(quote (kafetofe-1970 ruhafe-1971 qukamidr-1972 giqudr-1973 rujumito-1974 drne-1975 podrlo-1976 kalopofe-1977 tolo-1978 giju-1979))
+(quote (neju-1980 posaqusa-1981 drquvisa-1982 qujuju-1983 quha-1984 gimigiju-1985 qururu-1986 runequka-1987 miha-1988 kamilogi-1989))
+(quote (hadrfe-1990 migi-1991 virujuru-1992 jufehalo-1993 feviqu-1994 julo-1995 torujudr-1996 gifequru-1997 drsahafe-1998 nepohavi-1999))
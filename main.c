@@ -1,43 +1,132 @@
 #include "runi_lisp.h"
 
 #include <stdio.h>
+#include <unistd.h>
+
+static struct runi_context *ctx;
+static struct runi_object *env;
+
+static void print_gc_stats(void) {
+    struct runi_gc_stats stats;
+    runi_gc_get_stats(ctx, &stats);
+    fprintf(stderr, "gc: heap-size=%zu live-bytes=%zu live-objects=%zu collections=%zu "
+            "allocated-bytes=%zu allocated-objects=%zu freed-bytes=%zu freed-objects=%zu "
+            "chunks=%zu arena-bytes=%zu\n",
+            stats.heap_size, stats.live_bytes, stats.live_objects, stats.collections,
+            stats.total_allocated_bytes, stats.total_allocated_objects,
+            stats.total_freed_bytes, stats.total_freed_objects,
+            stats.chunks, stats.arena_bytes);
+#ifdef RUNI_STATS
+    size_t len;
+    char *s = runi_print_to_string(ctx, runi_prim_stats(ctx, env, 0, NULL), &len);
+    fprintf(stderr, "stats: %s\n", s);
+    free(s);
+#endif
+}
+
+static void check_toplevel(struct runi_object *expr) {
+    if (expr == runi_cparen)
+        runi_error(ctx, "Stray close parenthesis");
+    if (expr == runi_dot)
+        runi_error(ctx, "Stray dot");
+}
+
+static void load_file(char *path) {
+    runi_load(ctx, env, path);
+    runi_arena_trim(ctx);
+}
+
+static void usage(char *prog) {
+    fprintf(stderr, "usage: %s [-b] [-m heap-size] [-d max-eval-depth] [-s] [-i image] [-j threads] [file ...]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t heap_size = RUNI_DEFAULT_HEAP_SIZE;
+    int max_eval_depth = RUNI_DEFAULT_MAX_EVAL_DEPTH;
+    bool vm_enabled = false;
+    bool stats = false;
+    char *image = NULL;
+    int nthreads = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "bm:d:si:j:")) != -1) {
+        switch (opt) {
+        case 'b':
+            vm_enabled = true;
+            break;
+        case 'm': {
+            char *end;
+            heap_size = strtoull(optarg, &end, 10);
+            if (*end == 'k' || *end == 'K')
+                heap_size <<= 10;
+            else if (*end == 'm' || *end == 'M')
+                heap_size <<= 20;
+            else if (*end == 'g' || *end == 'G')
+                heap_size <<= 30;
+            else if (*end != '\0')
+                usage(argv[0]);
+            break;
+        }
+        case 'd':
+            max_eval_depth = atoi(optarg);
+            if (max_eval_depth <= 0)
+                usage(argv[0]);
+            break;
+        case 's':
+            stats = true;
+            break;
+        case 'i':
+            image = optarg;
+            break;
+        case 'j':
+            nthreads = atoi(optarg);
+            if (nthreads <= 0)
+                usage(argv[0]);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
 
-int main(void) {
     printf("runi-lisp\n");
 
-    runi_nil = runi_make_special(RUNI_NIL);
-    runi_dot = runi_make_special(RUNI_DOT);
-    runi_cparen = runi_make_special(RUNI_CPAREN);
-    runi_true = runi_make_special(RUNI_TRUE);
-    runi_symbols = runi_nil;
-
-    struct runi_object *env = runi_make_env(runi_nil, NULL);
-
-    runi_add_variable(env, runi_intern("t"), runi_true);
-    runi_add_primitive(env, "quote", runi_prim_quote);
-    runi_add_primitive(env, "list", runi_prim_list);
-    runi_add_primitive(env, "setq", runi_prim_setq);
-    runi_add_primitive(env, "+", runi_prim_plus);
-    runi_add_primitive(env, "define", runi_prim_define);
-    runi_add_primitive(env, "defun", runi_prim_defun);
-    runi_add_primitive(env, "defmacro", runi_prim_defmacro);
-    runi_add_primitive(env, "macroexpand", runi_prim_macroexpand);
-    runi_add_primitive(env, "lambda", runi_prim_lambda);
-    runi_add_primitive(env, "if", runi_prim_if);
-    runi_add_primitive(env, "=", runi_prim_num_eq);
-    runi_add_primitive(env, "println", runi_prim_println);
-    runi_add_primitive(env, "exit", runi_prim_exit);
+    ctx = runi_context_new(heap_size);
+    if (!ctx) {
+        fprintf(stderr, "Memory exhausted\n");
+        return 1;
+    }
+    ctx->max_eval_depth = max_eval_depth;
+    ctx->vm_enabled = vm_enabled;
+    ctx->nthreads = nthreads;
+    if (stats)
+        atexit(print_gc_stats);
+
+    env = runi_make_env(ctx, runi_nil, NULL);
+    runi_gc_add_root(ctx, &env);
+
+    runi_add_primitives(ctx, env);
+
+    if (image)
+        runi_load_image(ctx, env, image);
+
+    for (int i = optind; i < argc; i++)
+        load_file(argv[i]);
 
     for (;;) {
-        struct runi_object *expr = runi_parse();
+        struct runi_handler handler;
+        if (setjmp(handler.buf)) {
+            fprintf(stderr, "%s\n", ctx->error);
+            continue;
+        }
+        runi_push_handler(ctx, &handler);
+        struct runi_object *expr = runi_parse(ctx);
         if (!expr)
             return 0;
-        if (expr == runi_cparen)
-            runi_error("Stray close parenthesis");
-        if (expr == runi_dot)
-            runi_error("Stray dot");
-        runi_print(runi_eval(env, expr));
+        check_toplevel(expr);
+        runi_print(ctx, runi_eval(ctx, env, expr));
         printf("\n");
+        runi_pop_handler(ctx, &handler);
+        runi_arena_trim(ctx);
     }
 
     return 0;
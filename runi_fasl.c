@@ -0,0 +1,769 @@
+#include "runi_lisp.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RUNI_FASL_MAGIC "RUNIFSL"
+#define RUNI_FASL_VERSION 3
+#define RUNI_FASL_MAX_DEPTH 10000
+
+enum {
+    FASL_NIL,
+    FASL_TRUE,
+    FASL_FIXNUM,
+    FASL_SYMBOL,
+    FASL_STRING,
+    FASL_LIST,
+    FASL_VECTOR,
+    FASL_EXPANDED,
+    FASL_SHARED,
+};
+
+struct runi_fasl_header {
+    char magic[8];
+    uint64_t version;
+    uint64_t mtime;
+    uint64_t size;
+    uint64_t hash;
+    uint64_t nsymbols;
+    uint64_t nforms;
+    uint64_t nbytes;
+};
+
+struct runi_fasl_buffer {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+};
+
+struct runi_fasl_table {
+    struct runi_object **keys;
+    uint64_t *indexes;
+    size_t cap;
+    size_t len;
+};
+
+struct runi_fasl_macro {
+    struct runi_object *sym;
+    uint64_t hash;
+};
+
+struct runi_fasl_writer {
+    struct runi_context *ctx;
+    struct runi_object *env;
+    struct runi_fasl_buffer strings;
+    struct runi_fasl_buffer forms;
+    struct runi_fasl_buffer body;
+    struct runi_fasl_table symbols;
+    struct runi_fasl_table shared;
+    size_t nforms;
+    struct runi_fasl_macro *macros;
+    size_t nmacros;
+    size_t capmacros;
+    bool failed;
+};
+
+static uint64_t source_hash(const unsigned char *s, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t source_mtime(struct stat *st) {
+    return (uint64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+static uint64_t mix(uint64_t h, uint64_t v) {
+    return (h ^ v) * 1099511628211ULL;
+}
+
+static uint64_t form_hash(uint64_t h, struct runi_object *obj, int depth) {
+    for (; depth <= RUNI_FASL_MAX_DEPTH; depth++) {
+        h = mix(h, runi_type(obj));
+        switch (runi_type(obj)) {
+        case RUNI_INTEGER:
+            return mix(h, runi_fixnum_value(obj));
+        case RUNI_SYMBOL:
+            return mix(h, source_hash((const unsigned char *)obj->name, strlen(obj->name)));
+        case RUNI_STRING:
+            return mix(h, source_hash((const unsigned char *)obj->chars, obj->nchars));
+        case RUNI_GLOBALREF:
+            return form_hash(h, obj->symbol, depth + 1);
+        case RUNI_LOCALREF:
+            return mix(mix(h, obj->depth), obj->index);
+        case RUNI_VECTOR:
+            for (size_t i = 0; i < obj->nitems; i++)
+                h = form_hash(h, obj->items[i], depth + 1);
+            return h;
+        case RUNI_LIST:
+            h = form_hash(h, obj->car, depth + 1);
+            obj = obj->cdr;
+            break;
+        default:
+            return h;
+        }
+    }
+    return h;
+}
+
+static uint64_t macro_hash(struct runi_object *macro) {
+    return form_hash(form_hash(14695981039346656037ULL, macro->args, 0), macro->body, 0);
+}
+
+static void put_byte(struct runi_fasl_writer *w, struct runi_fasl_buffer *b, unsigned char c) {
+    if (b->len == b->cap) {
+        b->cap = b->cap ? b->cap * 2 : 4096;
+        b->data = realloc(b->data, b->cap);
+        if (!b->data)
+            runi_error(w->ctx, "Memory exhausted");
+    }
+    b->data[b->len++] = c;
+}
+
+static void put_varint(struct runi_fasl_writer *w, struct runi_fasl_buffer *b, uint64_t n) {
+    for (; n >= 0x80; n >>= 7)
+        put_byte(w, b, n | 0x80);
+    put_byte(w, b, n);
+}
+
+static void put_bytes(struct runi_fasl_writer *w, struct runi_fasl_buffer *b, const char *s, size_t len) {
+    put_varint(w, b, len);
+    for (size_t i = 0; i < len; i++)
+        put_byte(w, b, s[i]);
+}
+
+static size_t slot_of(struct runi_fasl_table *t, struct runi_object *obj) {
+    size_t h = ((uintptr_t)obj >> 3) * 0x9e3779b97f4a7c15ULL >> 16;
+    size_t i = h & (t->cap - 1);
+    while (t->keys[i] && t->keys[i] != obj)
+        i = (i + 1) & (t->cap - 1);
+    return i;
+}
+
+static void grow_table(struct runi_fasl_writer *w, struct runi_fasl_table *t) {
+    struct runi_object **keys = t->keys;
+    uint64_t *indexes = t->indexes;
+    size_t cap = t->cap;
+    t->cap = cap ? cap * 2 : 256;
+    t->keys = calloc(t->cap, sizeof(*t->keys));
+    t->indexes = calloc(t->cap, sizeof(*t->indexes));
+    if (!t->keys || !t->indexes)
+        runi_error(w->ctx, "Memory exhausted");
+    for (size_t i = 0; i < cap; i++) {
+        if (!keys[i])
+            continue;
+        size_t j = slot_of(t, keys[i]);
+        t->keys[j] = keys[i];
+        t->indexes[j] = indexes[i];
+    }
+    free(keys);
+    free(indexes);
+}
+
+static bool table_add(struct runi_fasl_writer *w, struct runi_fasl_table *t, struct runi_object *obj, uint64_t *index) {
+    if ((t->len + 1) * 2 > t->cap)
+        grow_table(w, t);
+    size_t i = slot_of(t, obj);
+    bool added = !t->keys[i];
+    if (added) {
+        t->keys[i] = obj;
+        t->indexes[i] = t->len++;
+    }
+    *index = t->indexes[i];
+    return added;
+}
+
+static bool table_get(struct runi_fasl_table *t, struct runi_object *obj, uint64_t *index) {
+    if (!t->len)
+        return false;
+    size_t i = slot_of(t, obj);
+    *index = t->indexes[i];
+    return t->keys[i] != NULL;
+}
+
+static void table_clear(struct runi_fasl_table *t) {
+    if (t->len)
+        memset(t->keys, 0, sizeof(*t->keys) * t->cap);
+    t->len = 0;
+}
+
+static void table_free(struct runi_fasl_table *t) {
+    free(t->keys);
+    free(t->indexes);
+}
+
+static uint64_t symbol_index(struct runi_fasl_writer *w, struct runi_object *sym) {
+    uint64_t index;
+    if (table_add(w, &w->symbols, sym, &index))
+        put_bytes(w, &w->strings, sym->name, strlen(sym->name));
+    return index;
+}
+
+static bool is_proper_list(struct runi_object *list, size_t *len) {
+    struct runi_object *slow = list;
+    size_t n = 0;
+    for (; runi_type(list) == RUNI_LIST; n++) {
+        list = list->cdr;
+        if (n & 1)
+            slow = slow->cdr;
+        if (list == slow)
+            return false;
+    }
+    *len = n;
+    return true;
+}
+
+static void put_macros(struct runi_fasl_writer *w) {
+    put_varint(w, &w->forms, w->nmacros);
+    for (size_t i = 0; i < w->nmacros; i++) {
+        put_varint(w, &w->forms, symbol_index(w, w->macros[i].sym));
+        put_varint(w, &w->forms, w->macros[i].hash);
+    }
+    w->nmacros = 0;
+}
+
+static void add_macro(struct runi_fasl_writer *w, struct runi_object *sym, uint64_t hash) {
+    for (size_t i = 0; i < w->nmacros; i++)
+        if (w->macros[i].sym == sym && w->macros[i].hash == hash)
+            return;
+    if (w->nmacros == w->capmacros) {
+        w->capmacros = w->capmacros ? w->capmacros * 2 : 8;
+        w->macros = realloc(w->macros, sizeof(*w->macros) * w->capmacros);
+        if (!w->macros)
+            runi_error(w->ctx, "Memory exhausted");
+    }
+    w->macros[w->nmacros].sym = sym;
+    w->macros[w->nmacros].hash = hash;
+    w->nmacros++;
+}
+
+static bool can_put(struct runi_object *obj, int depth) {
+    size_t len;
+    if (!obj || depth > RUNI_FASL_MAX_DEPTH)
+        return false;
+    if (obj == runi_nil || obj == runi_true)
+        return true;
+    switch (runi_type(obj)) {
+    case RUNI_INTEGER:
+    case RUNI_SYMBOL:
+    case RUNI_STRING:
+        return true;
+    case RUNI_LIST:
+        if (!is_proper_list(obj, &len))
+            return false;
+        for (; runi_type(obj) == RUNI_LIST; obj = obj->cdr)
+            if (!can_put(obj->car, depth + 1))
+                return false;
+        return can_put(obj, depth + 1);
+    case RUNI_VECTOR:
+        for (size_t i = 0; i < obj->nitems; i++)
+            if (!can_put(obj->items[i], depth + 1))
+                return false;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void put_form(struct runi_fasl_writer *w, struct runi_object *obj, int depth);
+
+static void put_list(struct runi_fasl_writer *w, struct runi_object *obj, int depth) {
+    struct runi_fasl_buffer *b = &w->body;
+    size_t len;
+    if (!is_proper_list(obj, &len)) {
+        w->failed = true;
+        return;
+    }
+    put_byte(w, b, FASL_LIST);
+    put_varint(w, b, len);
+    for (; runi_type(obj) == RUNI_LIST; obj = obj->cdr)
+        put_form(w, obj->car, depth + 1);
+    put_form(w, obj, depth + 1);
+}
+
+static bool put_expanded(struct runi_fasl_writer *w, struct runi_object *obj, int depth) {
+    struct runi_fasl_buffer *b = &w->body;
+    uint64_t index;
+    if (runi_type(obj->car) != RUNI_SYMBOL)
+        return false;
+    if (table_get(&w->shared, obj, &index)) {
+        put_byte(w, b, FASL_SHARED);
+        put_varint(w, b, index);
+        return true;
+    }
+    struct runi_object **slot = runi_find(w->ctx, w->env, obj->car);
+    if (!slot || runi_type(*slot) != RUNI_MACRO)
+        return false;
+    struct runi_object *expansion = runi_expansion_lookup(w->ctx, *slot, obj->cdr);
+    if (!expansion || !can_put(expansion, depth + 1))
+        return false;
+    put_byte(w, b, FASL_EXPANDED);
+    put_list(w, obj, depth + 1);
+    table_add(w, &w->shared, obj, &index);
+    add_macro(w, obj->car, macro_hash(*slot));
+    put_form(w, expansion, depth + 1);
+    return true;
+}
+
+static void put_form(struct runi_fasl_writer *w, struct runi_object *obj, int depth) {
+    struct runi_fasl_buffer *b = &w->body;
+    if (w->failed)
+        return;
+    if (!obj || depth > RUNI_FASL_MAX_DEPTH) {
+        w->failed = true;
+        return;
+    }
+    if (obj == runi_nil) {
+        put_byte(w, b, FASL_NIL);
+        return;
+    }
+    if (obj == runi_true) {
+        put_byte(w, b, FASL_TRUE);
+        return;
+    }
+    switch (runi_type(obj)) {
+    case RUNI_INTEGER: {
+        int64_t n = runi_fixnum_value(obj);
+        put_byte(w, b, FASL_FIXNUM);
+        put_varint(w, b, ((uint64_t)n << 1) ^ (uint64_t)(n >> 63));
+        break;
+    }
+    case RUNI_SYMBOL: {
+        uint64_t index = symbol_index(w, obj);
+        put_byte(w, b, FASL_SYMBOL);
+        put_varint(w, b, index);
+        break;
+    }
+    case RUNI_STRING:
+        put_byte(w, b, FASL_STRING);
+        put_bytes(w, b, obj->chars, obj->nchars);
+        break;
+    case RUNI_LIST:
+        if (!put_expanded(w, obj, depth))
+            put_list(w, obj, depth);
+        break;
+    case RUNI_VECTOR:
+        put_byte(w, b, FASL_VECTOR);
+        put_varint(w, b, obj->nitems);
+        for (size_t i = 0; i < obj->nitems; i++)
+            put_form(w, obj->items[i], depth + 1);
+        break;
+    default:
+        w->failed = true;
+    }
+}
+
+static void end_form(struct runi_fasl_writer *w) {
+    put_macros(w);
+    for (size_t i = 0; i < w->body.len; i++)
+        put_byte(w, &w->forms, w->body.data[i]);
+    w->body.len = 0;
+    table_clear(&w->shared);
+    w->nforms++;
+}
+
+static void write_fasl(struct runi_fasl_writer *w, const char *path, struct runi_fasl_header *header) {
+    size_t len = strlen(path);
+    char *tmp = malloc(len + 8);
+    if (!tmp)
+        return;
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".XXXXXX", 8);
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        free(tmp);
+        return;
+    }
+    fchmod(fd, 0644);
+    FILE *fp = fdopen(fd, "wb");
+    bool ok = fp
+        && fwrite(header, sizeof(*header), 1, fp) == 1
+        && fwrite(w->strings.data, 1, w->strings.len, fp) == w->strings.len
+        && fwrite(w->forms.data, 1, w->forms.len, fp) == w->forms.len;
+    if (fp ? fclose(fp) != 0 : close(fd) != 0)
+        ok = false;
+    if (!ok || rename(tmp, path) != 0)
+        unlink(tmp);
+    free(tmp);
+}
+
+static void check_toplevel(struct runi_context *ctx, struct runi_object *expr) {
+    if (expr == runi_cparen)
+        runi_error(ctx, "Stray close parenthesis");
+    if (expr == runi_dot)
+        runi_error(ctx, "Stray dot");
+}
+
+static struct runi_object *expand(struct runi_fasl_writer *w, struct runi_object *env, struct runi_object *form) {
+    struct runi_context *ctx = w->ctx;
+    for (;;) {
+        if (runi_type(form) != RUNI_LIST || runi_type(form->car) != RUNI_SYMBOL)
+            return form;
+        struct runi_object **slot = runi_find(ctx, env, form->car);
+        if (!slot || runi_type(*slot) != RUNI_MACRO)
+            return form;
+        add_macro(w, form->car, macro_hash(*slot));
+        form = runi_macroexpand(ctx, env, form);
+    }
+}
+
+static void compile_source(struct runi_fasl_writer *w, struct runi_object *env, const char *source, size_t len, uint64_t skip) {
+    struct runi_context *ctx = w->ctx;
+    struct runi_reader reader;
+    runi_reader_init_buffer(&reader, source, len);
+    struct runi_object *form;
+    for (uint64_t i = 0; (form = runi_read(ctx, &reader)); i++) {
+        check_toplevel(ctx, form);
+        if (i < skip)
+            continue;
+        form = expand(w, env, form);
+        runi_eval(ctx, env, form);
+        put_form(w, form, 0);
+        end_form(w);
+    }
+}
+
+struct runi_fasl_reader {
+    struct runi_context *ctx;
+    struct runi_object *env;
+    const char *path;
+    const unsigned char *data;
+    size_t len;
+    size_t pos;
+    size_t start;
+    struct runi_object **symbols;
+    size_t nsymbols;
+    struct runi_object **shared;
+    size_t nshared;
+    size_t capshared;
+};
+
+static void corrupt(struct runi_fasl_reader *r) {
+    runi_error(r->ctx, "load: %s is corrupt", r->path);
+}
+
+static unsigned char get_byte(struct runi_fasl_reader *r) {
+    if (r->pos >= r->len)
+        corrupt(r);
+    return r->data[r->pos++];
+}
+
+static uint64_t get_varint(struct runi_fasl_reader *r) {
+    uint64_t n = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        unsigned char c = get_byte(r);
+        n |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return n;
+    }
+    corrupt(r);
+    return 0;
+}
+
+static const char *get_bytes(struct runi_fasl_reader *r, size_t *len) {
+    *len = get_varint(r);
+    if (*len > r->len - r->pos)
+        corrupt(r);
+    const char *s = (const char *)r->data + r->pos;
+    r->pos += *len;
+    return s;
+}
+
+static struct runi_object *get_symbol(struct runi_fasl_reader *r) {
+    uint64_t index = get_varint(r);
+    if (index >= r->nsymbols)
+        corrupt(r);
+    return r->symbols[index];
+}
+
+static void add_shared(struct runi_fasl_reader *r, struct runi_object *form) {
+    if (r->nshared == r->capshared) {
+        r->capshared = r->capshared ? r->capshared * 2 : 64;
+        r->shared = realloc(r->shared, sizeof(*r->shared) * r->capshared);
+        if (!r->shared)
+            runi_error(r->ctx, "Memory exhausted");
+    }
+    r->shared[r->nshared++] = form;
+}
+
+static struct runi_object *get_form(struct runi_fasl_reader *r, int depth) {
+    struct runi_context *ctx = r->ctx;
+    size_t len;
+    const char *s;
+    if (depth > RUNI_FASL_MAX_DEPTH)
+        corrupt(r);
+    switch (get_byte(r)) {
+    case FASL_NIL:
+        return runi_nil;
+    case FASL_TRUE:
+        return runi_true;
+    case FASL_FIXNUM: {
+        uint64_t n = get_varint(r);
+        return runi_make_integer(ctx, (int64_t)(n >> 1) ^ -(int64_t)(n & 1));
+    }
+    case FASL_SYMBOL:
+        return get_symbol(r);
+    case FASL_STRING:
+        s = get_bytes(r, &len);
+        return runi_make_string_len(ctx, s, len);
+    case FASL_LIST: {
+        uint64_t n = get_varint(r);
+        if (n == 0 || n > r->len - r->pos)
+            corrupt(r);
+        struct runi_object *head = runi_cons(ctx, get_form(r, depth + 1), runi_nil);
+        struct runi_object *tail = head;
+        for (uint64_t i = 1; i < n; i++) {
+            tail->cdr = runi_cons(ctx, get_form(r, depth + 1), runi_nil);
+            tail = tail->cdr;
+        }
+        tail->cdr = get_form(r, depth + 1);
+        return head;
+    }
+    case FASL_VECTOR: {
+        uint64_t n = get_varint(r);
+        if (n > r->len - r->pos)
+            corrupt(r);
+        struct runi_object *vec = runi_make_vector(ctx, n, runi_nil);
+        for (size_t i = 0; i < n; i++)
+            vec->items[i] = get_form(r, depth + 1);
+        return vec;
+    }
+    case FASL_EXPANDED: {
+        struct runi_object *form = get_form(r, depth + 1);
+        if (runi_type(form) != RUNI_LIST || runi_type(form->car) != RUNI_SYMBOL)
+            corrupt(r);
+        add_shared(r, form);
+        struct runi_object *expansion = get_form(r, depth + 1);
+        struct runi_object **slot = runi_find(ctx, r->env, form->car);
+        if (slot && runi_type(*slot) == RUNI_MACRO)
+            runi_expansion_add(ctx, *slot, form->cdr, expansion);
+        return form;
+    }
+    case FASL_SHARED: {
+        uint64_t index = get_varint(r);
+        if (index >= r->nshared)
+            corrupt(r);
+        return r->shared[index];
+    }
+    }
+    corrupt(r);
+    return NULL;
+}
+
+static bool check_macros(struct runi_fasl_reader *r, struct runi_object *env) {
+    bool valid = true;
+    for (uint64_t n = get_varint(r); n > 0; n--) {
+        struct runi_object *sym = get_symbol(r);
+        uint64_t hash = get_varint(r);
+        struct runi_object **slot = runi_find(r->ctx, env, sym);
+        if (!slot || runi_type(*slot) != RUNI_MACRO || macro_hash(*slot) != hash)
+            valid = false;
+    }
+    return valid;
+}
+
+static uint64_t load_fasl(struct runi_fasl_reader *r, struct runi_object *env, const struct runi_fasl_header *header) {
+    struct runi_context *ctx = r->ctx;
+    for (size_t i = 0; i < r->nsymbols; i++) {
+        size_t len;
+        const char *name = get_bytes(r, &len);
+        r->symbols[i] = runi_intern_len(ctx, name, len);
+    }
+    r->start = r->pos;
+    for (uint64_t i = 0; i < header->nforms; i++) {
+        if (!check_macros(r, env))
+            return i;
+        r->nshared = 0;
+        runi_eval(ctx, env, get_form(r, 0));
+    }
+    if (r->pos != r->len)
+        corrupt(r);
+    return header->nforms;
+}
+
+static void copy_form(struct runi_fasl_reader *r, struct runi_fasl_writer *w, int depth) {
+    struct runi_fasl_buffer *b = &w->body;
+    size_t len;
+    const char *s;
+    if (depth > RUNI_FASL_MAX_DEPTH)
+        corrupt(r);
+    unsigned char tag = get_byte(r);
+    put_byte(w, b, tag);
+    switch (tag) {
+    case FASL_NIL:
+    case FASL_TRUE:
+        return;
+    case FASL_FIXNUM:
+    case FASL_SHARED:
+        put_varint(w, b, get_varint(r));
+        return;
+    case FASL_SYMBOL:
+        put_varint(w, b, symbol_index(w, get_symbol(r)));
+        return;
+    case FASL_STRING:
+        s = get_bytes(r, &len);
+        put_bytes(w, b, s, len);
+        return;
+    case FASL_LIST:
+    case FASL_VECTOR: {
+        uint64_t n = get_varint(r);
+        if (n > r->len - r->pos)
+            corrupt(r);
+        put_varint(w, b, n);
+        for (uint64_t i = 0; i < n; i++)
+            copy_form(r, w, depth + 1);
+        if (tag == FASL_LIST)
+            copy_form(r, w, depth + 1);
+        return;
+    }
+    case FASL_EXPANDED:
+        copy_form(r, w, depth + 1);
+        copy_form(r, w, depth + 1);
+        return;
+    }
+    corrupt(r);
+}
+
+static void copy_forms(struct runi_fasl_reader *r, struct runi_fasl_writer *w, uint64_t nforms) {
+    r->pos = r->start;
+    while (w->nforms < nforms) {
+        for (uint64_t n = get_varint(r); n > 0; n--) {
+            struct runi_object *sym = get_symbol(r);
+            add_macro(w, sym, get_varint(r));
+        }
+        copy_form(r, w, 0);
+        end_form(w);
+    }
+}
+
+static const struct runi_fasl_header *map_fasl(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct runi_fasl_header)) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+    const struct runi_fasl_header *header = map;
+    if (memcmp(header->magic, RUNI_FASL_MAGIC, 8) != 0 || header->version != RUNI_FASL_VERSION
+        || header->nbytes != st.st_size - sizeof(*header)) {
+        munmap(map, st.st_size);
+        return NULL;
+    }
+    *size = st.st_size;
+    return header;
+}
+
+struct runi_load_state {
+    char *fasl_path;
+    void *source;
+    size_t source_size;
+    const struct runi_fasl_header *fasl;
+    size_t fasl_size;
+    struct runi_fasl_writer writer;
+    struct runi_fasl_reader reader;
+};
+
+static void release(struct runi_load_state *s) {
+    free(s->fasl_path);
+    if (s->source)
+        munmap(s->source, s->source_size);
+    if (s->fasl)
+        munmap((void *)s->fasl, s->fasl_size);
+    free(s->writer.strings.data);
+    free(s->writer.forms.data);
+    free(s->writer.body.data);
+    table_free(&s->writer.symbols);
+    table_free(&s->writer.shared);
+    free(s->writer.macros);
+    free(s->reader.symbols);
+    free(s->reader.shared);
+}
+
+static void load(struct runi_context *ctx, struct runi_object *env, const char *path, struct runi_load_state *s) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        if (fd >= 0)
+            close(fd);
+        runi_error(ctx, "load: cannot read %s", path);
+    }
+    struct runi_fasl_header header = { RUNI_FASL_MAGIC, RUNI_FASL_VERSION, source_mtime(&st), st.st_size, 0, 0, 0, 0 };
+    s->source_size = st.st_size;
+    if (s->source_size > 0) {
+        s->source = mmap(NULL, s->source_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (s->source == MAP_FAILED) {
+            s->source = NULL;
+            close(fd);
+            runi_error(ctx, "load: cannot map %s", path);
+        }
+    }
+    close(fd);
+
+    size_t len = strlen(path);
+    s->fasl_path = malloc(len + sizeof(".fasl"));
+    if (!s->fasl_path)
+        runi_error(ctx, "Memory exhausted");
+    memcpy(s->fasl_path, path, len);
+    memcpy(s->fasl_path + len, ".fasl", sizeof(".fasl"));
+
+    s->fasl = map_fasl(s->fasl_path, &s->fasl_size);
+    if (s->fasl && s->fasl->size == header.size && s->fasl->mtime != header.mtime)
+        header.hash = source_hash(s->source, s->source_size);
+    struct runi_fasl_writer *w = &s->writer;
+    w->ctx = ctx;
+    w->env = env;
+    uint64_t loaded = 0;
+    if (s->fasl && s->fasl->size == header.size && (s->fasl->mtime == header.mtime || s->fasl->hash == header.hash)) {
+        struct runi_fasl_reader *r = &s->reader;
+        r->ctx = ctx;
+        r->env = env;
+        r->path = s->fasl_path;
+        r->data = (const unsigned char *)(s->fasl + 1);
+        r->len = s->fasl_size - sizeof(*s->fasl);
+        r->nsymbols = s->fasl->nsymbols;
+        r->symbols = calloc(r->nsymbols + 1, sizeof(*r->symbols));
+        if (!r->symbols)
+            runi_error(ctx, "Memory exhausted");
+        loaded = load_fasl(r, env, s->fasl);
+        if (loaded == s->fasl->nforms)
+            return;
+        copy_forms(r, w, loaded);
+    }
+
+    compile_source(w, env, s->source, s->source_size, loaded);
+    if (w->failed)
+        return;
+    header.hash = source_hash(s->source, s->source_size);
+    header.nsymbols = w->symbols.len;
+    header.nforms = w->nforms;
+    header.nbytes = w->strings.len + w->forms.len;
+    write_fasl(w, s->fasl_path, &header);
+}
+
+void runi_load(struct runi_context *ctx, struct runi_object *env, const char *path) {
+    struct runi_load_state state = { 0 };
+    struct runi_handler handler;
+    bool failed = setjmp(handler.buf);
+    if (!failed) {
+        runi_push_handler(ctx, &handler);
+        load(ctx, env, path, &state);
+        runi_pop_handler(ctx, &handler);
+    }
+    release(&state);
+    if (failed) {
+        char error[sizeof(ctx->error)];
+        memcpy(error, ctx->error, sizeof(error));
+        runi_error(ctx, "%s", error);
+    }
+}
@@ -0,0 +1,206 @@
+#include "runi_lisp.h"
+
+#define RUNI_HASH_MIGRATE_STEP 8
+#define RUNI_HASH_MAX_DEPTH 4
+#define RUNI_HASH_MAX_ELEMENTS 16
+#define RUNI_HASH_TOMBSTONE runi_cparen
+
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t equal_hash(struct runi_object *obj, int depth) {
+    switch (runi_type(obj)) {
+    case RUNI_STRING: {
+        uint64_t h = 14695981039346656037ULL;
+        for (size_t i = 0; i < obj->nchars; i++) {
+            h ^= (unsigned char)obj->chars[i];
+            h *= 1099511628211ULL;
+        }
+        return mix(h);
+    }
+    case RUNI_LIST: {
+        if (depth == 0)
+            return RUNI_LIST;
+        uint64_t h = 0x9e3779b97f4a7c15ULL;
+        int n = 0;
+        for (; runi_type(obj) == RUNI_LIST && n < RUNI_HASH_MAX_ELEMENTS; obj = obj->cdr, n++)
+            h = (h ^ equal_hash(obj->car, depth - 1)) * 0x100000001b3ULL;
+        if (n < RUNI_HASH_MAX_ELEMENTS)
+            h = (h ^ equal_hash(obj, depth - 1)) * 0x100000001b3ULL;
+        return mix(h);
+    }
+    default:
+        return mix((uintptr_t)obj);
+    }
+}
+
+static uint64_t atom_hash(struct runi_object *obj) {
+    return runi_type(obj) == RUNI_STRING ? equal_hash(obj, 0) : mix((uintptr_t)obj);
+}
+
+uint64_t runi_hash(struct runi_object *obj, int test) {
+    if (test == RUNI_HASH_EQUAL)
+        return equal_hash(obj, RUNI_HASH_MAX_DEPTH);
+    if (test == RUNI_HASH_CONS)
+        return mix(atom_hash(obj->car) * 31 + mix((uintptr_t)obj->cdr));
+    return mix((uintptr_t)obj);
+}
+
+bool runi_equal(struct runi_object *a, struct runi_object *b) {
+    for (;;) {
+        if (a == b)
+            return true;
+        int type = runi_type(a);
+        if (type != runi_type(b))
+            return false;
+        if (type == RUNI_STRING)
+            return a->nchars == b->nchars && memcmp(a->chars, b->chars, a->nchars) == 0;
+        if (type != RUNI_LIST || !runi_equal(a->car, b->car))
+            return false;
+        a = a->cdr;
+        b = b->cdr;
+    }
+}
+
+static bool same(struct runi_object *a, struct runi_object *b, int test) {
+    if (a == b)
+        return true;
+    if (test == RUNI_HASH_EQUAL)
+        return runi_equal(a, b);
+    if (test == RUNI_HASH_CONS)
+        return a->cdr == b->cdr && (a->car == b->car || (runi_type(a->car) == RUNI_STRING && runi_equal(a->car, b->car)));
+    return false;
+}
+
+static bool probe(struct runi_object *buckets, struct runi_object *key, int test, uint64_t hash, size_t *slot) {
+    size_t mask = buckets->nitems / 2 - 1;
+    size_t free = SIZE_MAX;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        struct runi_object *k = buckets->items[i * 2];
+        if (!k) {
+            *slot = free != SIZE_MAX ? free : i;
+            return false;
+        }
+        if (k == RUNI_HASH_TOMBSTONE) {
+            if (free == SIZE_MAX)
+                free = i;
+        } else if (same(k, key, test)) {
+            *slot = i;
+            return true;
+        }
+    }
+}
+
+static void migrate(struct runi_object *table, size_t steps) {
+    struct runi_object *old = table->old_buckets;
+    if (!old)
+        return;
+    size_t cap = old->nitems / 2;
+    for (; steps && table->hmigrated < cap; steps--, table->hmigrated++) {
+        struct runi_object *k = old->items[table->hmigrated * 2];
+        if (!k || k == RUNI_HASH_TOMBSTONE)
+            continue;
+        size_t slot;
+        probe(table->buckets, k, RUNI_HASH_EQ, runi_hash(k, table->htest), &slot);
+        if (!table->buckets->items[slot * 2])
+            table->hused++;
+        table->buckets->items[slot * 2] = k;
+        table->buckets->items[slot * 2 + 1] = old->items[table->hmigrated * 2 + 1];
+        old->items[table->hmigrated * 2] = RUNI_HASH_TOMBSTONE;
+        old->items[table->hmigrated * 2 + 1] = NULL;
+    }
+    if (table->hmigrated == cap)
+        table->old_buckets = NULL;
+}
+
+static void grow(struct runi_context *ctx, struct runi_object *table) {
+    migrate(table, SIZE_MAX);
+    size_t cap = RUNI_HASH_MIN_CAP;
+    while (cap < table->hcount * 4)
+        cap *= 2;
+    struct runi_object *buckets = runi_make_vector(ctx, cap * 2, NULL);
+    table->old_buckets = table->buckets;
+    table->buckets = buckets;
+    table->hused = 0;
+    table->hmigrated = 0;
+}
+
+struct runi_object *runi_hashtable_get(struct runi_object *table, struct runi_object *key) {
+    uint64_t hash = runi_hash(key, table->htest);
+    size_t slot;
+    if (probe(table->buckets, key, table->htest, hash, &slot))
+        return table->buckets->items[slot * 2 + 1];
+    if (table->old_buckets && probe(table->old_buckets, key, table->htest, hash, &slot))
+        return table->old_buckets->items[slot * 2 + 1];
+    return NULL;
+}
+
+void runi_hashtable_put(struct runi_context *ctx, struct runi_object *table, struct runi_object *key, struct runi_object *value) {
+    migrate(table, RUNI_HASH_MIGRATE_STEP);
+    if ((table->hused + 1) * 2 > table->buckets->nitems / 2)
+        grow(ctx, table);
+    uint64_t hash = runi_hash(key, table->htest);
+    size_t slot;
+    if (probe(table->buckets, key, table->htest, hash, &slot)) {
+        table->buckets->items[slot * 2 + 1] = value;
+        return;
+    }
+    size_t old;
+    if (table->old_buckets && probe(table->old_buckets, key, table->htest, hash, &old)) {
+        table->old_buckets->items[old * 2] = RUNI_HASH_TOMBSTONE;
+        table->old_buckets->items[old * 2 + 1] = NULL;
+        table->hcount--;
+    }
+    if (!table->buckets->items[slot * 2])
+        table->hused++;
+    table->buckets->items[slot * 2] = key;
+    table->buckets->items[slot * 2 + 1] = value;
+    table->hcount++;
+}
+
+bool runi_hashtable_remove(struct runi_object *table, struct runi_object *key) {
+    migrate(table, RUNI_HASH_MIGRATE_STEP);
+    uint64_t hash = runi_hash(key, table->htest);
+    struct runi_object *buckets[2] = { table->buckets, table->old_buckets };
+    bool found = false;
+    for (int i = 0; i < 2 && buckets[i]; i++) {
+        size_t slot;
+        if (probe(buckets[i], key, table->htest, hash, &slot)) {
+            buckets[i]->items[slot * 2] = RUNI_HASH_TOMBSTONE;
+            buckets[i]->items[slot * 2 + 1] = NULL;
+            found = true;
+        }
+    }
+    if (found)
+        table->hcount--;
+    return found;
+}
+
+void runi_hashtable_each(struct runi_object *table, void (*fn)(void *data, struct runi_object *key, struct runi_object *value), void *data) {
+    struct runi_object *buckets[2] = { table->buckets, table->old_buckets };
+    for (int i = 0; i < 2 && buckets[i]; i++) {
+        size_t start = buckets[i] == table->old_buckets ? table->hmigrated : 0;
+        for (size_t j = start; j < buckets[i]->nitems / 2; j++) {
+            struct runi_object *k = buckets[i]->items[j * 2];
+            if (k && k != RUNI_HASH_TOMBSTONE)
+                fn(data, k, buckets[i]->items[j * 2 + 1]);
+        }
+    }
+}
+
+void runi_hashtable_prune(struct runi_object *table, bool (*live)(struct runi_object *key)) {
+    migrate(table, SIZE_MAX);
+    struct runi_object *buckets = table->buckets;
+    for (size_t i = 0; i < buckets->nitems / 2; i++) {
+        struct runi_object *k = buckets->items[i * 2];
+        if (k && k != RUNI_HASH_TOMBSTONE && !live(k)) {
+            buckets->items[i * 2] = RUNI_HASH_TOMBSTONE;
+            buckets->items[i * 2 + 1] = NULL;
+            table->hcount--;
+        }
+    }
+}
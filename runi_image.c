@@ -0,0 +1,563 @@
+#include "runi_lisp.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RUNI_IMAGE_MAGIC "RUNIIMG"
+#define RUNI_IMAGE_VERSION 4
+
+enum {
+    RUNI_IMAGE_NULL = 0,
+    RUNI_IMAGE_NIL = 2,
+    RUNI_IMAGE_TRUE = 6,
+    RUNI_IMAGE_DOT = 10,
+    RUNI_IMAGE_LAMBDA_MARKER = 14,
+    RUNI_IMAGE_GUARD_MARKER = 18,
+};
+
+struct runi_image_header {
+    char magic[8];
+    uint64_t version;
+    uint64_t nrecords;
+    uint64_t env;
+};
+
+struct runi_image_writer {
+    struct runi_context *ctx;
+    struct runi_object **objects;
+    size_t nobjects;
+    size_t capobjects;
+    struct runi_object **keys;
+    uint64_t *indexes;
+    size_t capkeys;
+    uint64_t *words;
+    size_t nwords;
+    size_t capwords;
+};
+
+static size_t slot_of(struct runi_image_writer *w, struct runi_object *obj) {
+    size_t h = ((uintptr_t)obj >> 3) * 0x9e3779b97f4a7c15ULL >> 16;
+    size_t i = h & (w->capkeys - 1);
+    while (w->keys[i] && w->keys[i] != obj)
+        i = (i + 1) & (w->capkeys - 1);
+    return i;
+}
+
+static void grow_keys(struct runi_image_writer *w) {
+    struct runi_object **keys = w->keys;
+    uint64_t *indexes = w->indexes;
+    size_t cap = w->capkeys;
+    w->capkeys = cap ? cap * 2 : 1024;
+    w->keys = calloc(w->capkeys, sizeof(*w->keys));
+    w->indexes = calloc(w->capkeys, sizeof(*w->indexes));
+    if (!w->keys || !w->indexes)
+        runi_error(w->ctx, "Memory exhausted");
+    for (size_t i = 0; i < cap; i++) {
+        if (!keys[i])
+            continue;
+        size_t j = slot_of(w, keys[i]);
+        w->keys[j] = keys[i];
+        w->indexes[j] = indexes[i];
+    }
+    free(keys);
+    free(indexes);
+}
+
+static void put_ref(struct runi_image_writer *w, struct runi_object *obj);
+
+static bool is_immediate(struct runi_object *obj) {
+    return !obj || runi_is_fixnum(obj) || obj == runi_nil || obj == runi_true || obj == runi_dot || obj == runi_lambda_marker
+        || obj == runi_guard_marker;
+}
+
+static void visit(struct runi_image_writer *w, struct runi_object *obj) {
+    if (is_immediate(obj))
+        return;
+    if ((w->nobjects + 1) * 2 > w->capkeys)
+        grow_keys(w);
+    size_t i = slot_of(w, obj);
+    if (w->keys[i])
+        return;
+    if (runi_type(obj) == RUNI_CODE || runi_type(obj) == RUNI_CPAREN)
+        runi_error(w->ctx, "save-image: cannot save object of type %d", runi_type(obj));
+    w->keys[i] = obj;
+    w->indexes[i] = w->nobjects;
+    if (w->nobjects == w->capobjects) {
+        w->capobjects = w->capobjects ? w->capobjects * 2 : 1024;
+        w->objects = realloc(w->objects, sizeof(*w->objects) * w->capobjects);
+        if (!w->objects)
+            runi_error(w->ctx, "Memory exhausted");
+    }
+    w->objects[w->nobjects++] = obj;
+}
+
+static size_t primitive_names(struct runi_image_writer *w, struct runi_object *prim, bool emit) {
+    struct runi_context *ctx = w->ctx;
+    size_t n = 0;
+    for (size_t i = 0; i < ctx->symtab_cap; i++) {
+        struct runi_object *sym = ctx->symtab[i].sym;
+        if (!sym || sym->value != prim)
+            continue;
+        if (emit)
+            put_ref(w, sym);
+        else
+            visit(w, sym);
+        n++;
+    }
+    if (n == 0)
+        runi_error(ctx, "save-image: primitive is not bound to any symbol");
+    return n;
+}
+
+static void visit_entry(void *data, struct runi_object *key, struct runi_object *value) {
+    visit(data, key);
+    visit(data, value);
+}
+
+static void enumerate(struct runi_image_writer *w, struct runi_object *env) {
+    struct runi_context *ctx = w->ctx;
+    visit(w, env);
+    for (size_t i = 0; i < ctx->symtab_cap; i++)
+        if (ctx->symtab[i].sym)
+            visit(w, ctx->symtab[i].sym);
+    for (size_t n = 0; n < w->nobjects; n++) {
+        struct runi_object *obj = w->objects[n];
+        switch (runi_type(obj)) {
+        case RUNI_LIST:
+            visit(w, obj->car);
+            visit(w, obj->cdr);
+            break;
+        case RUNI_SYMBOL:
+            visit(w, obj->value);
+            break;
+        case RUNI_PRIMITIVE:
+            primitive_names(w, obj, false);
+            break;
+        case RUNI_FUNCTION:
+        case RUNI_MACRO:
+            visit(w, obj->env);
+            visit(w, obj->args);
+            visit(w, obj->body);
+            visit(w, obj->fname);
+            visit(w, obj->source);
+            visit(w, obj->deps);
+            visit(w, obj->memo);
+            break;
+        case RUNI_ENV:
+            visit(w, obj->vars);
+            visit(w, obj->parent);
+            break;
+        case RUNI_FRAME:
+            visit(w, obj->vars);
+            visit(w, obj->parent);
+            visit(w, obj->params);
+            for (size_t i = 0; i < obj->nslots; i++)
+                visit(w, obj->slots[i]);
+            break;
+        case RUNI_VECTOR:
+            for (size_t i = 0; i < obj->nitems; i++)
+                visit(w, obj->items[i]);
+            break;
+        case RUNI_HASHTABLE:
+            runi_hashtable_each(obj, visit_entry, w);
+            break;
+        case RUNI_LOCALREF:
+        case RUNI_GLOBALREF:
+            visit(w, obj->symbol);
+            break;
+        }
+    }
+}
+
+static void put(struct runi_image_writer *w, uint64_t word) {
+    if (w->nwords == w->capwords) {
+        w->capwords = w->capwords ? w->capwords * 2 : 4096;
+        w->words = realloc(w->words, sizeof(*w->words) * w->capwords);
+        if (!w->words)
+            runi_error(w->ctx, "Memory exhausted");
+    }
+    w->words[w->nwords++] = word;
+}
+
+static void put_ref(struct runi_image_writer *w, struct runi_object *obj) {
+    if (!obj)
+        put(w, RUNI_IMAGE_NULL);
+    else if (runi_is_fixnum(obj))
+        put(w, (uint64_t)(uintptr_t)obj);
+    else if (obj == runi_nil)
+        put(w, RUNI_IMAGE_NIL);
+    else if (obj == runi_true)
+        put(w, RUNI_IMAGE_TRUE);
+    else if (obj == runi_dot)
+        put(w, RUNI_IMAGE_DOT);
+    else if (obj == runi_lambda_marker)
+        put(w, RUNI_IMAGE_LAMBDA_MARKER);
+    else if (obj == runi_guard_marker)
+        put(w, RUNI_IMAGE_GUARD_MARKER);
+    else
+        put(w, (w->indexes[slot_of(w, obj)] + 1) << 2);
+}
+
+static void put_bytes(struct runi_image_writer *w, const char *s, size_t len) {
+    put(w, len);
+    for (size_t i = 0; i < len; i += 8) {
+        uint64_t word = 0;
+        memcpy(&word, s + i, len - i < 8 ? len - i : 8);
+        put(w, word);
+    }
+}
+
+static void put_entry(void *data, struct runi_object *key, struct runi_object *value) {
+    put_ref(data, key);
+    put_ref(data, value);
+}
+
+static void put_record(struct runi_image_writer *w, struct runi_object *obj) {
+    int type = runi_type(obj);
+    put(w, type);
+    switch (type) {
+    case RUNI_LIST:
+        put_ref(w, obj->car);
+        put_ref(w, obj->cdr);
+        break;
+    case RUNI_SYMBOL:
+        put_ref(w, obj->value);
+        put_bytes(w, obj->name, strlen(obj->name));
+        break;
+    case RUNI_STRING:
+        put_bytes(w, obj->chars, obj->nchars);
+        break;
+    case RUNI_PRIMITIVE:
+        put(w, primitive_names(w, obj, false));
+        primitive_names(w, obj, true);
+        break;
+    case RUNI_FUNCTION:
+    case RUNI_MACRO:
+        put_ref(w, obj->env);
+        put_ref(w, obj->args);
+        put_ref(w, obj->body);
+        put_ref(w, obj->fname);
+        put_ref(w, obj->source);
+        put_ref(w, obj->deps);
+        put_ref(w, obj->memo);
+        break;
+    case RUNI_ENV:
+        put_ref(w, obj->vars);
+        put_ref(w, obj->parent);
+        break;
+    case RUNI_FRAME:
+        put_ref(w, obj->vars);
+        put_ref(w, obj->parent);
+        put_ref(w, obj->params);
+        put(w, obj->nslots);
+        for (size_t i = 0; i < obj->nslots; i++)
+            put_ref(w, obj->slots[i]);
+        break;
+    case RUNI_VECTOR:
+        put(w, obj->nitems);
+        for (size_t i = 0; i < obj->nitems; i++)
+            put_ref(w, obj->items[i]);
+        break;
+    case RUNI_HASHTABLE:
+        put(w, obj->htest);
+        put(w, obj->hcount);
+        runi_hashtable_each(obj, put_entry, w);
+        break;
+    case RUNI_LOCALREF:
+        put_ref(w, obj->symbol);
+        put(w, obj->depth);
+        put(w, obj->index);
+        break;
+    case RUNI_GLOBALREF:
+        put_ref(w, obj->symbol);
+        break;
+    default:
+        runi_error(w->ctx, "Bug: save-image: Unknown tag type: %d", type);
+    }
+}
+
+void runi_save_image(struct runi_context *ctx, struct runi_object *env, const char *path) {
+    struct runi_image_writer w = { .ctx = ctx };
+    enumerate(&w, env);
+    for (size_t i = 0; i < w.nobjects; i++)
+        put_record(&w, w.objects[i]);
+
+    struct runi_image_header header = { RUNI_IMAGE_MAGIC, RUNI_IMAGE_VERSION, w.nobjects, 0 };
+    header.env = (w.indexes[slot_of(&w, env)] + 1) << 2;
+    FILE *fp = fopen(path, "wb");
+    bool ok = fp
+        && fwrite(&header, sizeof(header), 1, fp) == 1
+        && fwrite(w.words, sizeof(*w.words), w.nwords, fp) == w.nwords;
+    if (fp && fclose(fp) != 0)
+        ok = false;
+    free(w.objects);
+    free(w.keys);
+    free(w.indexes);
+    free(w.words);
+    if (!ok)
+        runi_error(ctx, "save-image: cannot write %s", path);
+}
+
+struct runi_image_reader {
+    struct runi_context *ctx;
+    const uint64_t *words;
+    size_t nwords;
+    size_t pos;
+    struct runi_object **objects;
+    size_t nobjects;
+};
+
+static uint64_t get(struct runi_image_reader *r) {
+    if (r->pos >= r->nwords)
+        runi_error(r->ctx, "load-image: truncated image");
+    return r->words[r->pos++];
+}
+
+static struct runi_object *get_ref(struct runi_image_reader *r) {
+    uint64_t word = get(r);
+    if ((word & 3) == RUNI_FIXNUM_TAG)
+        return (struct runi_object *)(uintptr_t)word;
+    switch (word) {
+    case RUNI_IMAGE_NULL:
+        return NULL;
+    case RUNI_IMAGE_NIL:
+        return runi_nil;
+    case RUNI_IMAGE_TRUE:
+        return runi_true;
+    case RUNI_IMAGE_DOT:
+        return runi_dot;
+    case RUNI_IMAGE_LAMBDA_MARKER:
+        return runi_lambda_marker;
+    case RUNI_IMAGE_GUARD_MARKER:
+        return runi_guard_marker;
+    }
+    uint64_t index = (word >> 2) - 1;
+    if ((word & 3) != 0 || index >= r->nobjects)
+        runi_error(r->ctx, "load-image: corrupt reference");
+    return r->objects[index];
+}
+
+static const char *get_bytes(struct runi_image_reader *r, size_t *len) {
+    *len = get(r);
+    size_t n = (*len + 7) / 8;
+    if (r->pos + n > r->nwords)
+        runi_error(r->ctx, "load-image: truncated image");
+    const char *s = (const char *)&r->words[r->pos];
+    r->pos += n;
+    return s;
+}
+
+static uint64_t peek(struct runi_image_reader *r, size_t i) {
+    if (r->pos + i >= r->nwords)
+        runi_error(r->ctx, "load-image: truncated image");
+    return r->words[r->pos + i];
+}
+
+static size_t record_size(struct runi_image_reader *r, int type) {
+    switch (type) {
+    case RUNI_LIST:
+    case RUNI_ENV:
+        return 2;
+    case RUNI_LOCALREF:
+        return 3;
+    case RUNI_FUNCTION:
+    case RUNI_MACRO:
+        return 7;
+    case RUNI_GLOBALREF:
+        return 1;
+    case RUNI_PRIMITIVE:
+        return 1 + peek(r, 0);
+    case RUNI_SYMBOL:
+        return 2 + (peek(r, 1) + 7) / 8;
+    case RUNI_STRING:
+        return 1 + (peek(r, 0) + 7) / 8;
+    case RUNI_FRAME:
+        return 4 + peek(r, 3);
+    case RUNI_VECTOR:
+        return 1 + peek(r, 0);
+    case RUNI_HASHTABLE:
+        return 2 + peek(r, 1) * 2;
+    default:
+        runi_error(r->ctx, "load-image: corrupt record type %d", type);
+    }
+}
+
+static struct runi_object *allocate(struct runi_image_reader *r, int type) {
+    struct runi_context *ctx = r->ctx;
+    size_t len;
+    const char *s;
+    switch (type) {
+    case RUNI_LIST:
+        return runi_cons(ctx, runi_nil, runi_nil);
+    case RUNI_SYMBOL:
+        r->pos++;
+        s = get_bytes(r, &len);
+        return runi_intern_len(ctx, s, len);
+    case RUNI_STRING:
+        s = get_bytes(r, &len);
+        return runi_make_string_len(ctx, s, len);
+    case RUNI_PRIMITIVE:
+        return NULL;
+    case RUNI_FUNCTION:
+    case RUNI_MACRO:
+        return runi_make_function(ctx, type, runi_nil, runi_nil, runi_nil);
+    case RUNI_ENV:
+        return runi_make_env(ctx, runi_nil, NULL);
+    case RUNI_FRAME:
+        return runi_make_frame(ctx, NULL, runi_nil, r->words[r->pos + 3]);
+    case RUNI_VECTOR:
+        return runi_make_vector(ctx, r->words[r->pos], runi_nil);
+    case RUNI_HASHTABLE:
+        return runi_make_hashtable(ctx, r->words[r->pos] == RUNI_HASH_EQUAL ? RUNI_HASH_EQUAL : RUNI_HASH_EQ);
+    case RUNI_LOCALREF:
+        return runi_make_localref(ctx, NULL, 0, 0);
+    case RUNI_GLOBALREF:
+        return runi_make_globalref(ctx, NULL);
+    }
+    return NULL;
+}
+
+static void fill(struct runi_image_reader *r, struct runi_object *obj, int type) {
+    size_t len;
+    switch (type) {
+    case RUNI_LIST:
+        obj->car = get_ref(r);
+        obj->cdr = get_ref(r);
+        break;
+    case RUNI_SYMBOL:
+        obj->value = get_ref(r);
+        get_bytes(r, &len);
+        break;
+    case RUNI_STRING:
+        get_bytes(r, &len);
+        break;
+    case RUNI_FUNCTION:
+    case RUNI_MACRO:
+        obj->env = get_ref(r);
+        obj->args = get_ref(r);
+        obj->body = get_ref(r);
+        obj->fname = get_ref(r);
+        obj->source = get_ref(r);
+        obj->deps = get_ref(r);
+        obj->memo = get_ref(r);
+        break;
+    case RUNI_ENV:
+        obj->vars = get_ref(r);
+        obj->parent = get_ref(r);
+        break;
+    case RUNI_FRAME:
+        obj->vars = get_ref(r);
+        obj->parent = get_ref(r);
+        obj->params = get_ref(r);
+        get(r);
+        for (size_t i = 0; i < obj->nslots; i++)
+            obj->slots[i] = get_ref(r);
+        break;
+    case RUNI_VECTOR:
+        get(r);
+        for (size_t i = 0; i < obj->nitems; i++)
+            obj->items[i] = get_ref(r);
+        break;
+    case RUNI_LOCALREF:
+        obj->symbol = get_ref(r);
+        obj->depth = get(r);
+        obj->index = get(r);
+        break;
+    case RUNI_GLOBALREF:
+        obj->symbol = get_ref(r);
+        break;
+    }
+}
+
+static void load(struct runi_image_reader *r, struct runi_object *env, size_t envindex, size_t *offsets) {
+    struct runi_context *ctx = r->ctx;
+    for (size_t i = 0; i < r->nobjects; i++) {
+        int type = get(r);
+        offsets[i] = r->pos;
+        size_t size = record_size(r, type);
+        if (size > r->nwords - r->pos)
+            runi_error(ctx, "load-image: truncated image");
+        r->objects[i] = i == envindex ? env : allocate(r, type);
+        r->pos = offsets[i] + size;
+    }
+    for (size_t i = 0; i < r->nobjects; i++) {
+        r->pos = offsets[i] - 1;
+        if (get(r) != RUNI_PRIMITIVE)
+            continue;
+        struct runi_object *sym = NULL;
+        for (size_t n = get(r); n > 0 && !r->objects[i]; n--) {
+            sym = get_ref(r);
+            if (sym && runi_type(sym) == RUNI_SYMBOL && sym->value && runi_type(sym->value) == RUNI_PRIMITIVE)
+                r->objects[i] = sym->value;
+        }
+        if (!r->objects[i])
+            runi_error(ctx, "load-image: primitive %s is not defined", sym ? sym->name : "?");
+    }
+    for (size_t i = 0; i < r->nobjects; i++) {
+        r->pos = offsets[i] - 1;
+        int type = get(r);
+        if (type != RUNI_PRIMITIVE && i != envindex)
+            fill(r, r->objects[i], type);
+    }
+    for (size_t i = 0; i < r->nobjects; i++) {
+        r->pos = offsets[i] - 1;
+        if (get(r) != RUNI_HASHTABLE)
+            continue;
+        get(r);
+        for (size_t n = get(r); n > 0; n--) {
+            struct runi_object *key = get_ref(r);
+            runi_hashtable_put(ctx, r->objects[i], key, get_ref(r));
+        }
+    }
+}
+
+void runi_load_image(struct runi_context *ctx, struct runi_object *env, const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct runi_image_header)) {
+        if (fd >= 0)
+            close(fd);
+        runi_error(ctx, "load-image: cannot read %s", path);
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        runi_error(ctx, "load-image: cannot map %s", path);
+    const struct runi_image_header *header = map;
+    size_t nwords = (st.st_size - sizeof(*header)) / 8;
+    if (memcmp(header->magic, RUNI_IMAGE_MAGIC, 8) != 0 || header->version != RUNI_IMAGE_VERSION
+        || header->nrecords > nwords || header->env == 0 || (header->env >> 2) > header->nrecords) {
+        munmap(map, st.st_size);
+        runi_error(ctx, "load-image: %s is not a runi-lisp image", path);
+    }
+
+    struct runi_image_reader r = { ctx, (const uint64_t *)(header + 1), nwords, 0, NULL, header->nrecords };
+    r.objects = calloc(r.nobjects + 1, sizeof(*r.objects));
+    size_t *offsets = calloc(r.nobjects + 1, sizeof(*offsets));
+    if (!r.objects || !offsets) {
+        free(r.objects);
+        munmap(map, st.st_size);
+        runi_error(ctx, "Memory exhausted");
+    }
+
+    struct runi_handler handler;
+    bool failed = setjmp(handler.buf);
+    if (!failed) {
+        runi_push_handler(ctx, &handler);
+        ctx->gc_inhibit++;
+        load(&r, env, (header->env >> 2) - 1, offsets);
+        runi_pop_handler(ctx, &handler);
+    }
+    ctx->gc_inhibit--;
+    ctx->global_epoch++;
+    free(offsets);
+    free(r.objects);
+    munmap(map, st.st_size);
+    if (failed) {
+        char error[sizeof(ctx->error)];
+        memcpy(error, ctx->error, sizeof(error));
+        runi_error(ctx, "%s", error);
+    }
+}
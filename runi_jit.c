@@ -0,0 +1,808 @@
+#include "runi_lisp.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define RUNI_JIT_THRESHOLD 1000
+#define RUNI_JIT_HEADER 16
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+enum { CC_O = 0x0, CC_E = 0x4, CC_NE = 0x5, CC_L = 0xc, CC_GE = 0xd };
+
+struct runi_jit_frame {
+    struct runi_object *fn;
+    struct runi_object *code;
+    struct runi_object *frame;
+    struct runi_object **locals;
+    size_t prof_len;
+    struct runi_object *slots[];
+};
+
+struct runi_jit_fixup {
+    size_t at;
+    int target;
+};
+
+struct runi_jit {
+    struct runi_context *ctx;
+    struct runi_object *fn;
+    struct runi_object *code;
+    int32_t *ops;
+    int nops;
+    int *depth;
+    bool *target;
+    size_t *labels;
+    uint8_t *buf;
+    size_t len;
+    size_t cap;
+    struct runi_jit_fixup *fixups;
+    int nfixups;
+    int capfixups;
+    size_t body;
+};
+
+static struct runi_object runi_jit_tail_marker = { .type = RUNI_NIL };
+
+static const int op_length[] = {
+    [RUNI_OP_CONST] = 2, [RUNI_OP_LOCAL] = 2, [RUNI_OP_OUTER] = 3, [RUNI_OP_SETLOCAL] = 2,
+    [RUNI_OP_SETOUTER] = 3, [RUNI_OP_GLOBAL] = 2, [RUNI_OP_EVAL] = 2, [RUNI_OP_CALLEE] = 4,
+    [RUNI_OP_CHECKFN] = 3, [RUNI_OP_BUILTIN] = 5, [RUNI_OP_GUARD] = 3, [RUNI_OP_CALL] = 2, [RUNI_OP_TAILCALL] = 2,
+    [RUNI_OP_ADD] = 2, [RUNI_OP_SUB] = 2, [RUNI_OP_NUMEQ] = 2, [RUNI_OP_LT] = 2,
+    [RUNI_OP_JUMP] = 2, [RUNI_OP_JUMPNIL] = 2, [RUNI_OP_POP] = 1, [RUNI_OP_RET] = 1,
+};
+
+static struct runi_object *jit_env(struct runi_context *ctx, struct runi_jit_frame *jf) {
+    if (jf->frame != runi_nil)
+        return jf->frame;
+    int nparams = jf->code->nparams;
+    struct runi_object *frame = runi_make_frame(ctx, jf->fn->env, jf->fn->args, nparams);
+    for (int i = 0; i < nparams; i++)
+        frame->slots[i] = jf->locals[i];
+    jf->frame = frame;
+    jf->locals = frame->slots;
+    return frame;
+}
+
+static struct runi_object *jit_eval(struct runi_context *ctx, struct runi_jit_frame *jf, struct runi_object *form) {
+    return runi_eval(ctx, jit_env(ctx, jf), form);
+}
+
+static struct runi_object *jit_global(struct runi_context *ctx, struct runi_jit_frame *jf, struct runi_object *sym) {
+    struct runi_object **slot = runi_find(ctx, jf->frame != runi_nil ? jf->frame : jf->fn->env, sym);
+    if (!slot)
+        runi_error(ctx, "Undefined symbol: %s", sym->name);
+    return *slot;
+}
+
+static struct runi_object *jit_globalref(struct runi_context *ctx, struct runi_jit_frame *jf, struct runi_object *ref) {
+    return runi_eval_globalref(ctx, jf->fn->env, ref);
+}
+
+static struct runi_object *jit_apply(struct runi_context *ctx, struct runi_jit_frame *jf, struct runi_object *callee, struct runi_object *form) {
+    return runi_apply(ctx, jit_env(ctx, jf), callee, form->cdr);
+}
+
+static void jit_too_deep(struct runi_context *ctx) {
+    runi_error(ctx, "Recursion too deep: evaluation depth exceeds %d", ctx->max_eval_depth);
+}
+
+static struct runi_object *jit_tail(struct runi_context *ctx, struct runi_object *callee, int argc, struct runi_object **argv) {
+    ctx->jit_tail_fn = callee;
+    ctx->jit_tail_argc = argc;
+    memcpy(ctx->jit_tail_args, argv, sizeof(*argv) * argc);
+    return &runi_jit_tail_marker;
+}
+
+static struct runi_object *jit_finish(struct runi_context *ctx) {
+    int argc = ctx->jit_tail_argc;
+    struct runi_object *argv[RUNI_JIT_MAX_ARGS];
+    memcpy(argv, ctx->jit_tail_args, sizeof(*argv) * argc);
+    return runi_funcall(ctx, runi_nil, ctx->jit_tail_fn, argc, argv);
+}
+
+static struct runi_object *jit_trampoline(struct runi_context *ctx) {
+    for (;;) {
+        struct runi_object *fn = ctx->jit_tail_fn;
+        int argc = ctx->jit_tail_argc;
+        if (runi_type(fn) != RUNI_FUNCTION)
+            return jit_finish(ctx);
+        if (!runi_jit_ready(ctx, fn) || fn->code->nparams != argc)
+            return NULL;
+        struct runi_object *argv[RUNI_JIT_MAX_ARGS];
+        memcpy(argv, ctx->jit_tail_args, sizeof(*argv) * argc);
+        struct runi_object *r = fn->native(ctx, argv);
+        if (r != &runi_jit_tail_marker)
+            return r;
+    }
+}
+
+static struct runi_object *jit_resume(struct runi_context *ctx) {
+    struct runi_object *r = jit_trampoline(ctx);
+    return r ? r : jit_finish(ctx);
+}
+
+static void reclaim(struct runi_context *ctx);
+
+struct runi_object *runi_jit_enter(struct runi_context *ctx, struct runi_object *fn, struct runi_object **argv) {
+    if (ctx->jit_depth == 0 && ctx->jit_nretired)
+        reclaim(ctx);
+    ctx->jit_depth++;
+    struct runi_object *r = fn->native(ctx, argv);
+    if (r == &runi_jit_tail_marker)
+        r = jit_trampoline(ctx);
+    ctx->jit_depth--;
+    return r;
+}
+
+struct runi_object *runi_jit_call(struct runi_context *ctx, struct runi_object *fn, struct runi_object **argv) {
+    struct runi_object *r = runi_jit_enter(ctx, fn, argv);
+    return r ? r : jit_finish(ctx);
+}
+
+static void byte(struct runi_jit *j, int b) {
+    if (j->len == j->cap) {
+        j->cap = j->cap ? j->cap * 2 : 1024;
+        j->buf = realloc(j->buf, j->cap);
+        if (!j->buf)
+            runi_error(j->ctx, "Memory exhausted");
+    }
+    j->buf[j->len++] = b;
+}
+
+static void word32(struct runi_jit *j, uint32_t v) {
+    for (int i = 0; i < 4; i++)
+        byte(j, v >> (i * 8));
+}
+
+static void word64(struct runi_jit *j, uint64_t v) {
+    for (int i = 0; i < 8; i++)
+        byte(j, v >> (i * 8));
+}
+
+static void mem_operand(struct runi_jit *j, int reg, int base, int32_t disp) {
+    byte(j, 0x80 | (reg & 7) << 3 | (base & 7));
+    if ((base & 7) == RSP)
+        byte(j, 0x24);
+    word32(j, disp);
+}
+
+static void mem(struct runi_jit *j, int op, int reg, int base, int32_t disp) {
+    byte(j, 0x48 | (reg & 8) >> 1 | (base & 8) >> 3);
+    byte(j, op);
+    mem_operand(j, reg, base, disp);
+}
+
+static void mem32(struct runi_jit *j, int op, int reg, int base, int32_t disp) {
+    if ((reg | base) & 8)
+        byte(j, 0x40 | (reg & 8) >> 1 | (base & 8) >> 3);
+    byte(j, op);
+    mem_operand(j, reg, base, disp);
+}
+
+static void rr(struct runi_jit *j, int op, int src, int dst) {
+    byte(j, 0x48 | (src & 8) >> 1 | (dst & 8) >> 3);
+    byte(j, op);
+    byte(j, 0xc0 | (src & 7) << 3 | (dst & 7));
+}
+
+static void load(struct runi_jit *j, int reg, int base, int32_t disp) {
+    mem(j, 0x8b, reg, base, disp);
+}
+
+static void store(struct runi_jit *j, int base, int32_t disp, int reg) {
+    mem(j, 0x89, reg, base, disp);
+}
+
+static void imm(struct runi_jit *j, int reg, uint64_t v) {
+    byte(j, 0x48 | (reg & 8) >> 3);
+    byte(j, 0xb8 + (reg & 7));
+    word64(j, v);
+}
+
+static void imm_ptr(struct runi_jit *j, int reg, void *p) {
+    imm(j, reg, (uintptr_t)p);
+}
+
+static void call_reg(struct runi_jit *j, int reg) {
+    if (reg & 8)
+        byte(j, 0x41);
+    byte(j, 0xff);
+    byte(j, 0xd0 | (reg & 7));
+}
+
+static void call(struct runi_jit *j, uintptr_t fn) {
+    imm(j, RAX, fn);
+    call_reg(j, RAX);
+}
+
+static size_t jcc(struct runi_jit *j, int cc) {
+    byte(j, 0x0f);
+    byte(j, 0x80 | cc);
+    word32(j, 0);
+    return j->len - 4;
+}
+
+static size_t jmp(struct runi_jit *j) {
+    byte(j, 0xe9);
+    word32(j, 0);
+    return j->len - 4;
+}
+
+static void patch_to(struct runi_jit *j, size_t at, size_t to) {
+    uint32_t rel = (uint32_t)(to - (at + 4));
+    memcpy(j->buf + at, &rel, 4);
+}
+
+static void here(struct runi_jit *j, size_t at) {
+    patch_to(j, at, j->len);
+}
+
+static void fixup(struct runi_jit *j, size_t at, int target) {
+    if (j->nfixups == j->capfixups) {
+        j->capfixups = j->capfixups ? j->capfixups * 2 : 32;
+        j->fixups = realloc(j->fixups, sizeof(*j->fixups) * j->capfixups);
+        if (!j->fixups)
+            runi_error(j->ctx, "Memory exhausted");
+    }
+    j->fixups[j->nfixups].at = at;
+    j->fixups[j->nfixups].target = target;
+    j->nfixups++;
+}
+
+static int32_t slot(struct runi_jit *j, int i) {
+    return offsetof(struct runi_jit_frame, slots) + sizeof(struct runi_object *) * (j->code->nparams + i);
+}
+
+static int32_t frame_size(struct runi_jit *j) {
+    int32_t n = slot(j, j->code->nstack);
+    return ((n + 15) & ~15) + 8;
+}
+
+static void helper_args(struct runi_jit *j) {
+    rr(j, 0x89, R13, RDI);
+    rr(j, 0x89, RBX, RSI);
+}
+
+static void reload_locals(struct runi_jit *j) {
+    load(j, R12, RBX, offsetof(struct runi_jit_frame, locals));
+}
+
+static void check_fixnums(struct runi_jit *j, size_t *slow) {
+    rr(j, 0x89, RAX, RDX);
+    rr(j, 0x21, RCX, RDX);
+    rr(j, 0xf7, 0, RDX);
+    word32(j, 1);
+    *slow = jcc(j, CC_E);
+}
+
+static void resolve(struct runi_jit *j, struct runi_object *ref) {
+    imm_ptr(j, RCX, ref);
+    load(j, RAX, RCX, offsetof(struct runi_object, epoch));
+    mem(j, 0x3b, RAX, R13, offsetof(struct runi_context, global_epoch));
+    size_t slow = jcc(j, CC_NE);
+    load(j, RAX, RCX, offsetof(struct runi_object, cache));
+    size_t done = jmp(j);
+    here(j, slow);
+    helper_args(j);
+    rr(j, 0x89, RCX, RDX);
+    call(j, (uintptr_t)jit_globalref);
+    here(j, done);
+}
+
+static void apply_slow(struct runi_jit *j, struct runi_object *form, int result, int skip) {
+    rr(j, 0x89, RAX, RDX);
+    helper_args(j);
+    imm_ptr(j, RCX, form);
+    call(j, (uintptr_t)jit_apply);
+    reload_locals(j);
+    store(j, RBX, slot(j, result), RAX);
+    fixup(j, jmp(j), skip);
+}
+
+static size_t check_function(struct runi_jit *j) {
+    byte(j, 0x48);
+    byte(j, 0xa9);
+    word32(j, 3);
+    size_t notfn = jcc(j, CC_NE);
+    mem32(j, 0x81, 7, RAX, offsetof(struct runi_object, type));
+    word32(j, RUNI_FUNCTION);
+    size_t other = jcc(j, CC_NE);
+    size_t ok = jmp(j);
+    here(j, notfn);
+    here(j, other);
+    return ok;
+}
+
+static size_t check_self(struct runi_jit *j, size_t *generic) {
+    imm_ptr(j, RCX, j->fn);
+    rr(j, 0x39, RCX, RAX);
+    generic[0] = jcc(j, CC_NE);
+    load(j, RCX, RAX, offsetof(struct runi_object, native));
+    rr(j, 0x85, RCX, RCX);
+    generic[1] = jcc(j, CC_E);
+    if (!j->fn->source)
+        return 2;
+    load(j, RDX, RAX, offsetof(struct runi_object, depoch));
+    mem(j, 0x3b, RDX, R13, offsetof(struct runi_context, global_epoch));
+    generic[2] = jcc(j, CC_NE);
+    return 3;
+}
+
+static void compile_call(struct runi_jit *j, int d, int argc, bool tail) {
+    int callee = d - argc - 1;
+    size_t generic[3];
+    load(j, RAX, RBX, slot(j, callee));
+    size_t ngeneric = check_self(j, generic);
+    if (tail) {
+        mem(j, 0x8d, R12, RBX, slot(j, -j->code->nparams));
+        store(j, RBX, offsetof(struct runi_jit_frame, locals), R12);
+        imm_ptr(j, RAX, runi_nil);
+        store(j, RBX, offsetof(struct runi_jit_frame, frame), RAX);
+        for (int i = 0; i < argc; i++) {
+            load(j, RAX, RBX, slot(j, callee + 1 + i));
+            store(j, R12, sizeof(struct runi_object *) * i, RAX);
+        }
+        patch_to(j, jmp(j), j->body);
+    } else {
+        rr(j, 0x89, R13, RDI);
+        mem(j, 0x8d, RSI, RBX, slot(j, callee + 1));
+        call_reg(j, RCX);
+        imm_ptr(j, RCX, &runi_jit_tail_marker);
+        rr(j, 0x39, RCX, RAX);
+        size_t done = jcc(j, CC_NE);
+        rr(j, 0x89, R13, RDI);
+        call(j, (uintptr_t)jit_resume);
+        here(j, done);
+    }
+    size_t direct = jmp(j);
+    for (size_t i = 0; i < ngeneric; i++)
+        here(j, generic[i]);
+    rr(j, 0x89, R13, RDI);
+    if (tail && argc <= RUNI_JIT_MAX_ARGS) {
+        rr(j, 0x89, RAX, RSI);
+        imm(j, RDX, argc);
+        mem(j, 0x8d, RCX, RBX, slot(j, callee + 1));
+        call(j, (uintptr_t)jit_tail);
+        fixup(j, jmp(j), j->nops);
+    } else {
+        rr(j, 0x89, RAX, RDX);
+        imm_ptr(j, RSI, runi_nil);
+        imm(j, RCX, argc);
+        mem(j, 0x8d, R8, RBX, slot(j, callee + 1));
+        call(j, (uintptr_t)runi_funcall);
+    }
+    here(j, direct);
+    store(j, RBX, slot(j, callee), RAX);
+}
+
+static void arith_slow(struct runi_jit *j, int op, int argc, int at) {
+    rr(j, 0x89, R13, RDI);
+    imm(j, RSI, op);
+    imm(j, RDX, argc);
+    mem(j, 0x8d, RCX, RBX, slot(j, at));
+    call(j, (uintptr_t)runi_vm_arith);
+}
+
+static void compile_arith(struct runi_jit *j, int op, int d, int argc) {
+    int at = d - argc;
+    if (argc != 2) {
+        arith_slow(j, op, argc, at);
+        store(j, RBX, slot(j, at), RAX);
+        return;
+    }
+    size_t slow[2];
+    load(j, RAX, RBX, slot(j, at));
+    load(j, RCX, RBX, slot(j, at + 1));
+    check_fixnums(j, &slow[0]);
+    rr(j, 0x89, RAX, RDX);
+    if (op == RUNI_OP_ADD) {
+        rr(j, 0x83, 5, RDX);
+        byte(j, 1);
+        rr(j, 0x01, RCX, RDX);
+        slow[1] = jcc(j, CC_O);
+    } else {
+        rr(j, 0x29, RCX, RDX);
+        slow[1] = jcc(j, CC_O);
+        rr(j, 0x83, 0, RDX);
+        byte(j, 1);
+    }
+    store(j, RBX, slot(j, at), RDX);
+    size_t done = jmp(j);
+    here(j, slow[0]);
+    here(j, slow[1]);
+    arith_slow(j, op, argc, at);
+    store(j, RBX, slot(j, at), RAX);
+    here(j, done);
+}
+
+static bool compile_compare(struct runi_jit *j, int op, int d, int pc) {
+    int at = d - 2;
+    int next = pc + op_length[op];
+    bool fused = next < j->nops && j->ops[next] == RUNI_OP_JUMPNIL && !j->target[next];
+    int cc = op == RUNI_OP_NUMEQ ? CC_E : CC_L;
+    size_t slow;
+    load(j, RAX, RBX, slot(j, at));
+    load(j, RCX, RBX, slot(j, at + 1));
+    check_fixnums(j, &slow);
+    rr(j, 0x39, RCX, RAX);
+    if (fused) {
+        fixup(j, jcc(j, cc ^ 1), j->ops[next + 1]);
+        size_t done = jmp(j);
+        here(j, slow);
+        arith_slow(j, op, 2, at);
+        imm_ptr(j, RCX, runi_nil);
+        rr(j, 0x39, RCX, RAX);
+        fixup(j, jcc(j, CC_E), j->ops[next + 1]);
+        here(j, done);
+        j->labels[next] = j->len;
+        return true;
+    }
+    imm_ptr(j, RDX, runi_nil);
+    imm_ptr(j, RSI, runi_true);
+    byte(j, 0x48);
+    byte(j, 0x0f);
+    byte(j, 0x40 | cc);
+    byte(j, 0xc0 | RDX << 3 | RSI);
+    size_t done = jmp(j);
+    here(j, slow);
+    arith_slow(j, op, 2, at);
+    rr(j, 0x89, RAX, RDX);
+    here(j, done);
+    store(j, RBX, slot(j, at), RDX);
+    return false;
+}
+
+static bool set_depth(struct runi_jit *j, int pc, int d) {
+    if (pc < 0 || pc > j->nops || d < 0 || d > j->code->nstack)
+        return false;
+    if (j->depth[pc] >= 0 && j->depth[pc] != d)
+        return false;
+    j->depth[pc] = d;
+    return true;
+}
+
+static bool jump_depth(struct runi_jit *j, int pc, int d) {
+    if (!set_depth(j, pc, d))
+        return false;
+    j->target[pc] = true;
+    return true;
+}
+
+static bool analyze(struct runi_jit *j) {
+    int d = 0;
+    for (int pc = 0; pc < j->nops;) {
+        int op = j->ops[pc];
+        if (op < 0 || op > RUNI_OP_RET || pc + op_length[op] > j->nops)
+            return false;
+        if (d < 0)
+            d = j->depth[pc];
+        if (!set_depth(j, pc, d))
+            return false;
+        int32_t *a = &j->ops[pc + 1];
+        bool ok = true;
+        switch (op) {
+        case RUNI_OP_CONST:
+        case RUNI_OP_LOCAL:
+        case RUNI_OP_GLOBAL:
+        case RUNI_OP_EVAL:
+            d++;
+            break;
+        case RUNI_OP_OUTER:
+        case RUNI_OP_SETOUTER:
+            return false;
+        case RUNI_OP_SETLOCAL:
+            ok = d >= 1;
+            break;
+        case RUNI_OP_CALLEE:
+            d++;
+            ok = jump_depth(j, a[2], d);
+            break;
+        case RUNI_OP_CHECKFN:
+            ok = d >= 1 && jump_depth(j, a[1], d);
+            break;
+        case RUNI_OP_BUILTIN:
+            ok = jump_depth(j, a[3], d + 1);
+            break;
+        case RUNI_OP_GUARD:
+            ok = jump_depth(j, a[1], d);
+            break;
+        case RUNI_OP_CALL:
+        case RUNI_OP_TAILCALL:
+            d -= a[0];
+            ok = d >= 1;
+            break;
+        case RUNI_OP_ADD:
+        case RUNI_OP_SUB:
+            d += 1 - a[0];
+            ok = d >= 1 && (op == RUNI_OP_ADD || a[0] >= 1);
+            break;
+        case RUNI_OP_NUMEQ:
+        case RUNI_OP_LT:
+            d--;
+            ok = d >= 1;
+            break;
+        case RUNI_OP_JUMP:
+            ok = jump_depth(j, a[0], d);
+            d = -1;
+            break;
+        case RUNI_OP_JUMPNIL:
+            d--;
+            ok = jump_depth(j, a[0], d);
+            break;
+        case RUNI_OP_POP:
+            d--;
+            ok = d >= 0;
+            break;
+        case RUNI_OP_RET:
+            ok = d >= 1;
+            d = -1;
+            break;
+        }
+        if (!ok || d > j->code->nstack)
+            return false;
+        pc += op_length[op];
+    }
+    return true;
+}
+
+static void prologue(struct runi_jit *j) {
+    byte(j, 0x55);
+    rr(j, 0x89, RSP, RBP);
+    byte(j, 0x53);
+    byte(j, 0x41);
+    byte(j, 0x54);
+    byte(j, 0x41);
+    byte(j, 0x55);
+    rr(j, 0x81, 5, RSP);
+    word32(j, frame_size(j));
+    rr(j, 0x89, RSP, RBX);
+    rr(j, 0x89, RDI, R13);
+    imm_ptr(j, RAX, j->fn);
+    store(j, RBX, offsetof(struct runi_jit_frame, fn), RAX);
+    imm_ptr(j, RAX, j->code);
+    store(j, RBX, offsetof(struct runi_jit_frame, code), RAX);
+    imm_ptr(j, RAX, runi_nil);
+    store(j, RBX, offsetof(struct runi_jit_frame, frame), RAX);
+    mem(j, 0x8d, R12, RBX, slot(j, -j->code->nparams));
+    store(j, RBX, offsetof(struct runi_jit_frame, locals), R12);
+    for (int i = 0; i < j->code->nparams; i++) {
+        load(j, RAX, RSI, sizeof(struct runi_object *) * i);
+        store(j, R12, sizeof(struct runi_object *) * i, RAX);
+    }
+
+    mem32(j, 0x8b, RAX, R13, offsetof(struct runi_context, eval_depth));
+    mem32(j, 0x3b, RAX, R13, offsetof(struct runi_context, max_eval_depth));
+    size_t ok = jcc(j, CC_L);
+    rr(j, 0x89, R13, RDI);
+    call(j, (uintptr_t)jit_too_deep);
+    here(j, ok);
+    mem32(j, 0xff, 0, R13, offsetof(struct runi_context, eval_depth));
+
+    load(j, RAX, R13, offsetof(struct runi_context, prof_len));
+    store(j, RBX, offsetof(struct runi_jit_frame, prof_len), RAX);
+    rr(j, 0x81, 7, RAX);
+    word32(j, RUNI_PROF_MAX_DEPTH);
+    size_t full = jcc(j, CC_GE);
+    imm_ptr(j, RCX, j->fn->fname);
+    mem(j, 0x8d, RDX, R13, offsetof(struct runi_context, prof_stack));
+    byte(j, 0x48);
+    byte(j, 0x89);
+    byte(j, 0x0c);
+    byte(j, 0xc2);
+    here(j, full);
+    rr(j, 0x83, 0, RAX);
+    byte(j, 1);
+    store(j, R13, offsetof(struct runi_context, prof_len), RAX);
+    j->body = j->len;
+}
+
+static void epilogue(struct runi_jit *j) {
+    mem32(j, 0xff, 1, R13, offsetof(struct runi_context, eval_depth));
+    load(j, RCX, RBX, offsetof(struct runi_jit_frame, prof_len));
+    store(j, R13, offsetof(struct runi_context, prof_len), RCX);
+    rr(j, 0x81, 0, RSP);
+    word32(j, frame_size(j));
+    byte(j, 0x41);
+    byte(j, 0x5d);
+    byte(j, 0x41);
+    byte(j, 0x5c);
+    byte(j, 0x5b);
+    byte(j, 0x5d);
+    byte(j, 0xc3);
+}
+
+static void compile_op(struct runi_jit *j, int *pc) {
+    struct runi_object **consts = j->code->consts;
+    int op = j->ops[*pc];
+    int32_t *a = &j->ops[*pc + 1];
+    int d = j->depth[*pc];
+    switch (op) {
+    case RUNI_OP_CONST:
+        imm_ptr(j, RAX, consts[a[0]]);
+        store(j, RBX, slot(j, d), RAX);
+        break;
+    case RUNI_OP_LOCAL:
+        load(j, RAX, R12, sizeof(struct runi_object *) * a[0]);
+        store(j, RBX, slot(j, d), RAX);
+        break;
+    case RUNI_OP_SETLOCAL:
+        load(j, RAX, RBX, slot(j, d - 1));
+        store(j, R12, sizeof(struct runi_object *) * a[0], RAX);
+        break;
+    case RUNI_OP_GLOBAL:
+    case RUNI_OP_EVAL:
+        helper_args(j);
+        imm_ptr(j, RDX, consts[a[0]]);
+        call(j, op == RUNI_OP_GLOBAL ? (uintptr_t)jit_global : (uintptr_t)jit_eval);
+        reload_locals(j);
+        store(j, RBX, slot(j, d), RAX);
+        break;
+    case RUNI_OP_CALLEE: {
+        resolve(j, consts[a[0]]);
+        size_t ok = check_function(j);
+        apply_slow(j, consts[a[1]], d, a[2]);
+        here(j, ok);
+        store(j, RBX, slot(j, d), RAX);
+        break;
+    }
+    case RUNI_OP_CHECKFN: {
+        load(j, RAX, RBX, slot(j, d - 1));
+        size_t ok = check_function(j);
+        apply_slow(j, consts[a[0]], d - 1, a[1]);
+        here(j, ok);
+        break;
+    }
+    case RUNI_OP_BUILTIN: {
+        resolve(j, consts[a[0]]);
+        imm_ptr(j, RCX, consts[a[1]]);
+        rr(j, 0x39, RCX, RAX);
+        size_t ok = jcc(j, CC_E);
+        apply_slow(j, consts[a[2]], d, a[3]);
+        here(j, ok);
+        break;
+    }
+    case RUNI_OP_GUARD:
+        for (struct runi_object *p = consts[a[0]]; p != runi_nil; p = p->cdr) {
+            imm_ptr(j, RCX, p->car->car);
+            load(j, RAX, RCX, offsetof(struct runi_object, value));
+            imm_ptr(j, RCX, p->car->cdr);
+            rr(j, 0x39, RCX, RAX);
+            fixup(j, jcc(j, CC_NE), a[1]);
+        }
+        break;
+    case RUNI_OP_CALL:
+    case RUNI_OP_TAILCALL:
+        compile_call(j, d, a[0], op == RUNI_OP_TAILCALL);
+        break;
+    case RUNI_OP_ADD:
+    case RUNI_OP_SUB:
+        compile_arith(j, op, d, a[0]);
+        break;
+    case RUNI_OP_NUMEQ:
+    case RUNI_OP_LT:
+        if (compile_compare(j, op, d, *pc))
+            *pc += op_length[RUNI_OP_JUMPNIL];
+        break;
+    case RUNI_OP_JUMP:
+        fixup(j, jmp(j), a[0]);
+        break;
+    case RUNI_OP_JUMPNIL:
+        load(j, RAX, RBX, slot(j, d - 1));
+        imm_ptr(j, RCX, runi_nil);
+        rr(j, 0x39, RCX, RAX);
+        fixup(j, jcc(j, CC_E), a[0]);
+        break;
+    case RUNI_OP_POP:
+        break;
+    case RUNI_OP_RET:
+        load(j, RAX, RBX, slot(j, d - 1));
+        fixup(j, jmp(j), j->nops);
+        break;
+    }
+    *pc += op_length[op];
+}
+
+static runi_native *install(struct runi_jit *j) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = (RUNI_JIT_HEADER + j->len + page - 1) / page * page;
+    char *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return NULL;
+    memcpy(mem, &size, sizeof(size));
+    memcpy(mem + RUNI_JIT_HEADER, j->buf, j->len);
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        return NULL;
+    }
+    mem += RUNI_JIT_HEADER;
+    runi_native *entry;
+    memcpy(&entry, &mem, sizeof(entry));
+    return entry;
+}
+
+void runi_jit_free(runi_native *native) {
+    char *mem;
+    size_t size;
+    memcpy(&mem, &native, sizeof(mem));
+    mem -= RUNI_JIT_HEADER;
+    memcpy(&size, mem, sizeof(size));
+    munmap(mem, size);
+}
+
+void runi_jit_retire(struct runi_context *ctx, runi_native *native) {
+    if (ctx->jit_nretired == ctx->jit_capretired) {
+        size_t cap = ctx->jit_capretired ? ctx->jit_capretired * 2 : 16;
+        runi_native **retired = realloc(ctx->jit_retired, sizeof(*retired) * cap);
+        if (!retired) {
+            runi_jit_free(native);
+            return;
+        }
+        ctx->jit_retired = retired;
+        ctx->jit_capretired = cap;
+    }
+    ctx->jit_retired[ctx->jit_nretired++] = native;
+}
+
+static void reclaim(struct runi_context *ctx) {
+    for (size_t i = 0; i < ctx->jit_nretired; i++)
+        runi_jit_free(ctx->jit_retired[i]);
+    ctx->jit_nretired = 0;
+}
+
+static runi_native *compile(struct runi_context *ctx, struct runi_object *fn) {
+    struct runi_jit j = { .ctx = ctx, .fn = fn, .code = fn->code };
+    j.ops = runi_code_ops(j.code);
+    j.nops = j.code->ncode;
+    j.depth = malloc(sizeof(*j.depth) * (j.nops + 1));
+    j.target = calloc(j.nops + 1, sizeof(*j.target));
+    j.labels = calloc(j.nops + 1, sizeof(*j.labels));
+    if (!j.depth || !j.target || !j.labels) {
+        free(j.depth);
+        free(j.target);
+        free(j.labels);
+        runi_error(ctx, "Memory exhausted");
+    }
+    for (int i = 0; i <= j.nops; i++)
+        j.depth[i] = -1;
+    runi_native *entry = NULL;
+    if (j.code->nparams <= RUNI_JIT_MAX_ARGS && analyze(&j)) {
+        prologue(&j);
+        for (int pc = 0; pc < j.nops;) {
+            j.labels[pc] = j.len;
+            compile_op(&j, &pc);
+        }
+        j.labels[j.nops] = j.len;
+        epilogue(&j);
+        for (int i = 0; i < j.nfixups; i++)
+            patch_to(&j, j.fixups[i].at, j.labels[j.fixups[i].target]);
+        entry = install(&j);
+    }
+    free(j.depth);
+    free(j.target);
+    free(j.labels);
+    free(j.fixups);
+    free(j.buf);
+    return entry;
+}
+
+bool runi_jit_ready(struct runi_context *ctx, struct runi_object *fn) {
+#if defined(__x86_64__)
+    if (fn->calls < 0 || fn->memo || runi_function_body(ctx, fn) != fn->body)
+        return false;
+    if (fn->native)
+        return true;
+    if (ctx->parent)
+        return false;
+    if (++fn->calls < RUNI_JIT_THRESHOLD)
+        return false;
+    if (!fn->fname || runi_type(fn->env) != RUNI_ENV || fn->env->parent || !runi_vm_compile(ctx, fn)
+        || !(fn->native = compile(ctx, fn)))
+        fn->calls = -1;
+    return fn->native != NULL;
+#else
+    (void)ctx;
+    (void)fn;
+    return false;
+#endif
+}
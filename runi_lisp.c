@@ -1,519 +1,2800 @@
+#define _GNU_SOURCE
 #include "runi_lisp.h"
 
-struct runi_object *runi_nil = NULL;
-struct runi_object *runi_dot = NULL;
-struct runi_object *runi_cparen = NULL;
-struct runi_object *runi_true = NULL;
-struct runi_object *runi_symbols = NULL;
+#include <pthread.h>
+#include <setjmp.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-void runi_error(char *fmt, ...) {
+#define RUNI_GC_MARK 1
+#define RUNI_GC_STATIC 2
+#define RUNI_ARENA_GRANULE 8
+#define RUNI_ARENA_MAX_SMALL 256
+#define RUNI_ARENA_CLASSES (RUNI_ARENA_MAX_SMALL / RUNI_ARENA_GRANULE + 1)
+#define RUNI_ARENA_CHUNK_SIZE (256 * 1024)
+#define RUNI_OPT_MAX_DEPTH 8
+#define RUNI_OPT_INLINE_NODES 24
+#define RUNI_OPT_INLINE_PARAMS 8
+
+static struct runi_object runi_nil_object = { .type = RUNI_NIL, .flags = RUNI_GC_STATIC };
+static struct runi_object runi_dot_object = { .type = RUNI_DOT, .flags = RUNI_GC_STATIC };
+static struct runi_object runi_cparen_object = { .type = RUNI_CPAREN, .flags = RUNI_GC_STATIC };
+static struct runi_object runi_true_object = { .type = RUNI_TRUE, .flags = RUNI_GC_STATIC };
+
+struct runi_object *const runi_nil = &runi_nil_object;
+struct runi_object *const runi_dot = &runi_dot_object;
+struct runi_object *const runi_cparen = &runi_cparen_object;
+struct runi_object *const runi_true = &runi_true_object;
+
+void runi_error(struct runi_context *ctx, char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
+    if (ctx && ctx->handler) {
+        vsnprintf(ctx->error, sizeof(ctx->error), fmt, ap);
+        va_end(ap);
+        struct runi_handler *h = ctx->handler;
+        ctx->handler = h->prev;
+        ctx->eval_depth = h->eval_depth;
+        ctx->vm_top = h->vm_top;
+        ctx->vm_ncalls = h->vm_ncalls;
+        ctx->prof_len = h->prof_len;
+        ctx->jit_depth = h->jit_depth;
+        longjmp(h->buf, 1);
+    }
     vfprintf(stderr, fmt, ap);
     fprintf(stderr, "\n");
     va_end(ap);
     exit(1);
 }
 
-static struct runi_object *runi_alloc(int type, size_t size) {
-    size += offsetof(struct runi_object, integer);
-    struct runi_object *obj = malloc(size);
+void runi_push_handler(struct runi_context *ctx, struct runi_handler *h) {
+    h->prev = ctx->handler;
+    h->eval_depth = ctx->eval_depth;
+    h->vm_top = ctx->vm_top;
+    h->vm_ncalls = ctx->vm_ncalls;
+    h->prof_len = ctx->prof_len;
+    h->jit_depth = ctx->jit_depth;
+    ctx->handler = h;
+}
+
+void runi_pop_handler(struct runi_context *ctx, struct runi_handler *h) {
+    assert(ctx->handler == h);
+    ctx->handler = h->prev;
+}
+
+struct runi_chunk {
+    struct runi_chunk *next;
+    size_t cell_size;
+    char *start;
+    char *bump;
+    char *end;
+    size_t live;
+};
+
+struct runi_arena {
+    size_t cell_size;
+    struct runi_chunk *chunks;
+    struct runi_chunk *cur;
+    struct runi_object *free;
+};
+
+struct runi_expansion {
+    struct runi_object *args;
+    struct runi_object *macro;
+    struct runi_object *expansion;
+};
+
+struct runi_gc_range {
+    void ***base;
+    size_t *len;
+};
+
+static void runi_print_file_sink(void *data, const char *buf, size_t len);
+
+struct runi_context *runi_context_new(size_t heap_size) {
+    struct runi_context *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return NULL;
+    ctx->arenas = calloc(RUNI_ARENA_CLASSES, sizeof(*ctx->arenas));
+    if (!ctx->arenas) {
+        free(ctx);
+        return NULL;
+    }
+    ctx->gc_stats.heap_size = heap_size;
+    ctx->global_epoch = 1;
+    ctx->max_eval_depth = RUNI_DEFAULT_MAX_EVAL_DEPTH;
+    ctx->jit_enabled = getenv("RUNI_NOJIT") == NULL;
+    ctx->memo_limit = RUNI_DEFAULT_MEMO_LIMIT;
+    runi_reader_init_fd(&ctx->input, STDIN_FILENO);
+    ctx->output = runi_print_file_sink;
+    ctx->output_data = stdout;
+    pthread_mutex_init(&ctx->symtab_lock, NULL);
+    return ctx;
+}
+
+struct runi_context *runi_context_new_child(struct runi_context *parent) {
+    struct runi_context *ctx = runi_context_new(parent->gc_stats.heap_size);
+    if (!ctx)
+        return NULL;
+    ctx->parent = parent;
+    ctx->gc_inhibit = 1;
+    ctx->global_epoch = parent->global_epoch;
+    ctx->max_eval_depth = parent->max_eval_depth;
+    ctx->vm_enabled = parent->vm_enabled;
+    ctx->jit_enabled = parent->jit_enabled;
+    ctx->memo_limit = parent->memo_limit;
+    ctx->output = parent->output;
+    ctx->output_data = parent->output_data;
+    return ctx;
+}
+
+void runi_context_free(struct runi_context *ctx) {
+    runi_par_pool_free(ctx);
+    for (size_t i = 0; i < RUNI_ARENA_CLASSES; i++) {
+        for (struct runi_chunk *c = ctx->arenas[i].chunks; c;) {
+            struct runi_chunk *next = c->next;
+            for (char *cell = c->start; cell < c->bump; cell += c->cell_size) {
+                struct runi_object *obj = (struct runi_object *)cell;
+                if (obj->type == RUNI_FUNCTION && obj->native)
+                    runi_jit_free(obj->native);
+            }
+            free(c);
+            c = next;
+        }
+    }
+    for (struct runi_chunk *c = ctx->large_objects; c;) {
+        struct runi_chunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    runi_reader_close(&ctx->input);
+    free(ctx->arenas);
+    free(ctx->chunk_table);
+    free(ctx->gc_roots);
+    free(ctx->gc_ranges);
+    free(ctx->mark_stack);
+    free(ctx->symtab);
+    free(ctx->expansions);
+    free(ctx->vm_stack);
+    free(ctx->vm_calls);
+    for (size_t i = 0; i < ctx->jit_nretired; i++)
+        runi_jit_free(ctx->jit_retired[i]);
+    free(ctx->jit_retired);
+    pthread_mutex_destroy(&ctx->symtab_lock);
+    free(ctx);
+}
+
+void runi_gc_add_root(struct runi_context *ctx, struct runi_object **root) {
+    if (ctx->gc_roots_len == ctx->gc_roots_cap) {
+        ctx->gc_roots_cap = ctx->gc_roots_cap ? ctx->gc_roots_cap * 2 : 16;
+        ctx->gc_roots = realloc(ctx->gc_roots, sizeof(*ctx->gc_roots) * ctx->gc_roots_cap);
+        if (!ctx->gc_roots)
+            runi_error(ctx, "Memory exhausted");
+    }
+    ctx->gc_roots[ctx->gc_roots_len++] = root;
+}
+
+void runi_gc_add_range(struct runi_context *ctx, void ***base, size_t *len) {
+    ctx->gc_ranges = realloc(ctx->gc_ranges, sizeof(*ctx->gc_ranges) * (ctx->gc_ranges_len + 1));
+    if (!ctx->gc_ranges)
+        runi_error(ctx, "Memory exhausted");
+    ctx->gc_ranges[ctx->gc_ranges_len].base = base;
+    ctx->gc_ranges[ctx->gc_ranges_len].len = len;
+    ctx->gc_ranges_len++;
+}
+
+void runi_gc_get_stats(struct runi_context *ctx, struct runi_gc_stats *stats) {
+    *stats = ctx->gc_stats;
+}
+
+static size_t runi_chunk_table_index(struct runi_context *ctx, char *p) {
+    size_t lo = 0, hi = ctx->chunk_table_len;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (ctx->chunk_table[mid]->start <= p)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void runi_chunk_register(struct runi_context *ctx, struct runi_chunk *c) {
+    if (ctx->chunk_table_len == ctx->chunk_table_cap) {
+        ctx->chunk_table_cap = ctx->chunk_table_cap ? ctx->chunk_table_cap * 2 : 64;
+        ctx->chunk_table = realloc(ctx->chunk_table, sizeof(*ctx->chunk_table) * ctx->chunk_table_cap);
+        if (!ctx->chunk_table)
+            runi_error(ctx, "Memory exhausted");
+    }
+    size_t lo = runi_chunk_table_index(ctx, c->start);
+    memmove(&ctx->chunk_table[lo + 1], &ctx->chunk_table[lo], sizeof(*ctx->chunk_table) * (ctx->chunk_table_len - lo));
+    ctx->chunk_table[lo] = c;
+    ctx->chunk_table_len++;
+    ctx->gc_stats.chunks++;
+    ctx->gc_stats.arena_bytes += c->end - c->start;
+}
+
+static void runi_chunk_release(struct runi_context *ctx, struct runi_chunk *c) {
+    size_t i = runi_chunk_table_index(ctx, c->start) - 1;
+    assert(ctx->chunk_table[i] == c);
+    memmove(&ctx->chunk_table[i], &ctx->chunk_table[i + 1], sizeof(*ctx->chunk_table) * (ctx->chunk_table_len - i - 1));
+    ctx->chunk_table_len--;
+    ctx->gc_stats.chunks--;
+    ctx->gc_stats.arena_bytes -= c->end - c->start;
+    free(c);
+}
+
+static struct runi_chunk *runi_chunk_new(struct runi_context *ctx, size_t cell_size, size_t bytes) {
+    size_t header = (sizeof(struct runi_chunk) + 15) & ~(size_t)15;
+    struct runi_chunk *c = malloc(header + bytes);
+    if (!c)
+        runi_error(ctx, "Memory exhausted");
+    c->next = NULL;
+    c->cell_size = cell_size;
+    c->start = (char *)c + header;
+    c->bump = c->start;
+    c->end = c->start + bytes;
+    c->live = 0;
+    return c;
+}
+
+void runi_context_join(struct runi_context *parent, struct runi_context *child) {
+    for (size_t i = 0; i < RUNI_ARENA_CLASSES; i++) {
+        struct runi_arena *from = &child->arenas[i], *to = &parent->arenas[i];
+        while (from->chunks) {
+            struct runi_chunk *c = from->chunks;
+            from->chunks = c->next;
+            c->next = to->chunks;
+            to->chunks = c;
+            to->cell_size = c->cell_size;
+            runi_chunk_register(parent, c);
+        }
+    }
+    while (child->large_objects) {
+        struct runi_chunk *c = child->large_objects;
+        child->large_objects = c->next;
+        c->next = parent->large_objects;
+        parent->large_objects = c;
+        runi_chunk_register(parent, c);
+    }
+    parent->gc_stats.live_bytes += child->gc_stats.live_bytes;
+    parent->child_bytes -= child->gc_stats.live_bytes;
+    parent->gc_stats.live_objects += child->gc_stats.live_objects;
+    parent->gc_stats.total_allocated_bytes += child->gc_stats.total_allocated_bytes;
+    parent->gc_stats.total_allocated_objects += child->gc_stats.total_allocated_objects;
+    parent->gc_stats.total_freed_bytes += child->gc_stats.total_freed_bytes;
+    parent->gc_stats.total_freed_objects += child->gc_stats.total_freed_objects;
+    if (child->global_epoch > parent->global_epoch)
+        parent->global_epoch = child->global_epoch + 1;
+#ifdef RUNI_STATS
+    for (int i = 0; i < RUNI_NTYPES; i++) {
+        parent->stats.eval_calls[i] += child->stats.eval_calls[i];
+        parent->stats.alloc_objects[i] += child->stats.alloc_objects[i];
+        parent->stats.alloc_bytes[i] += child->stats.alloc_bytes[i];
+    }
+    parent->stats.find_calls += child->stats.find_calls;
+    parent->stats.find_steps += child->stats.find_steps;
+    parent->stats.macroexpand_calls += child->stats.macroexpand_calls;
+    parent->stats.macroexpand_hits += child->stats.macroexpand_hits;
+    if (child->stats.max_eval_depth > parent->stats.max_eval_depth)
+        parent->stats.max_eval_depth = child->stats.max_eval_depth;
+#endif
+    runi_context_free(child);
+}
+
+static struct runi_object *runi_gc_lookup_chunk(struct runi_context *ctx, void *p) {
+    size_t lo = runi_chunk_table_index(ctx, (char *)p);
+    if (lo == 0)
+        return NULL;
+    struct runi_chunk *c = ctx->chunk_table[lo - 1];
+    if ((char *)p >= c->bump)
+        return NULL;
+    size_t off = (char *)p - c->start;
+    struct runi_object *obj = (struct runi_object *)(c->start + off / c->cell_size * c->cell_size);
+    return obj->type ? obj : NULL;
+}
+
+static struct runi_object *runi_gc_lookup(struct runi_context *ctx, void *p) {
+    struct runi_object *obj = runi_gc_lookup_chunk(ctx, p);
+    for (int i = 0; !obj && i < ctx->gc_nchildren; i++)
+        obj = runi_gc_lookup_chunk(ctx->gc_children[i], p);
+    return obj;
+}
+
+static bool runi_gc_is_marked(struct runi_object *obj) {
+    return runi_is_fixnum(obj) || (obj->flags & (RUNI_GC_MARK | RUNI_GC_STATIC));
+}
+
+static void runi_gc_mark(struct runi_context *ctx, struct runi_object *obj) {
+    if (!obj || runi_is_fixnum(obj) || (obj->flags & (RUNI_GC_MARK | RUNI_GC_STATIC)))
+        return;
+    obj->flags |= RUNI_GC_MARK;
+    if (ctx->mark_stack_len == ctx->mark_stack_cap) {
+        ctx->mark_stack_cap = ctx->mark_stack_cap ? ctx->mark_stack_cap * 2 : 256;
+        ctx->mark_stack = realloc(ctx->mark_stack, sizeof(*ctx->mark_stack) * ctx->mark_stack_cap);
+        if (!ctx->mark_stack)
+            runi_error(ctx, "Memory exhausted");
+    }
+    ctx->mark_stack[ctx->mark_stack_len++] = obj;
+}
+
+static void runi_gc_drain(struct runi_context *ctx) {
+    while (ctx->mark_stack_len) {
+        struct runi_object *obj = ctx->mark_stack[--ctx->mark_stack_len];
+        switch (obj->type) {
+        case RUNI_LIST:
+            runi_gc_mark(ctx, obj->car);
+            runi_gc_mark(ctx, obj->cdr);
+            break;
+        case RUNI_FUNCTION:
+        case RUNI_MACRO:
+            runi_gc_mark(ctx, obj->env);
+            runi_gc_mark(ctx, obj->args);
+            runi_gc_mark(ctx, obj->body);
+            runi_gc_mark(ctx, obj->code);
+            runi_gc_mark(ctx, obj->fname);
+            runi_gc_mark(ctx, obj->source);
+            runi_gc_mark(ctx, obj->deps);
+            runi_gc_mark(ctx, obj->memo);
+            break;
+        case RUNI_CODE:
+            for (int i = 0; i < obj->nconsts; i++)
+                runi_gc_mark(ctx, obj->consts[i]);
+            break;
+        case RUNI_ENV:
+            runi_gc_mark(ctx, obj->vars);
+            runi_gc_mark(ctx, obj->parent);
+            break;
+        case RUNI_FRAME:
+            runi_gc_mark(ctx, obj->vars);
+            runi_gc_mark(ctx, obj->parent);
+            runi_gc_mark(ctx, obj->params);
+            for (size_t i = 0; i < obj->nslots; i++)
+                runi_gc_mark(ctx, obj->slots[i]);
+            break;
+        case RUNI_SYMBOL:
+            runi_gc_mark(ctx, obj->value);
+            break;
+        case RUNI_STRING:
+            runi_gc_mark(ctx, obj->base);
+            break;
+        case RUNI_VECTOR:
+            for (size_t i = 0; i < obj->nitems; i++)
+                runi_gc_mark(ctx, obj->items[i]);
+            break;
+        case RUNI_HASHTABLE:
+            runi_gc_mark(ctx, obj->buckets);
+            runi_gc_mark(ctx, obj->old_buckets);
+            break;
+        case RUNI_LOCALREF:
+            runi_gc_mark(ctx, obj->symbol);
+            break;
+        case RUNI_GLOBALREF:
+            runi_gc_mark(ctx, obj->symbol);
+            runi_gc_mark(ctx, obj->cache);
+            break;
+        }
+    }
+}
+
+static void runi_gc_mark_expansions(struct runi_context *ctx) {
+    bool again = true;
+    while (again) {
+        again = false;
+        for (size_t i = 0; i < ctx->expansions_cap; i++) {
+            struct runi_expansion *e = &ctx->expansions[i];
+            if (!e->args || !runi_gc_is_marked(e->args) || runi_gc_is_marked(e->expansion))
+                continue;
+            runi_gc_mark(ctx, e->macro);
+            runi_gc_mark(ctx, e->expansion);
+            runi_gc_drain(ctx);
+            again = true;
+        }
+    }
+}
+
+static void runi_expansion_insert(struct runi_context *ctx, struct runi_expansion *e);
+
+static void runi_gc_prune_expansions(struct runi_context *ctx) {
+    struct runi_expansion *old = ctx->expansions;
+    size_t cap = ctx->expansions_cap;
+    ctx->expansions = calloc(cap, sizeof(*ctx->expansions));
+    if (!ctx->expansions)
+        runi_error(ctx, "Memory exhausted");
+    ctx->expansions_len = 0;
+    for (size_t i = 0; i < cap; i++)
+        if (old[i].args && runi_gc_is_marked(old[i].args))
+            runi_expansion_insert(ctx, &old[i]);
+    free(old);
+}
+
+static void runi_gc_hide_hcons(struct runi_context *ctx) {
+    struct runi_object *table = ctx->hcons;
+    table->flags |= RUNI_GC_MARK;
+    table->buckets->flags |= RUNI_GC_MARK;
+    if (table->old_buckets)
+        table->old_buckets->flags |= RUNI_GC_MARK;
+}
+
+void *runi_gc_stack_top(struct runi_context *ctx) {
+    pthread_t self = pthread_self();
+    if (!ctx->stack_top || !pthread_equal(ctx->stack_thread, self)) {
+        pthread_attr_t attr;
+        void *addr;
+        size_t size;
+        if (pthread_getattr_np(self, &attr) != 0)
+            runi_error(ctx, "Bug: gc: cannot determine stack bounds");
+        pthread_attr_getstack(&attr, &addr, &size);
+        pthread_attr_destroy(&attr);
+        ctx->stack_top = (char *)addr + size;
+        ctx->stack_thread = self;
+    }
+    return ctx->stack_top;
+}
+
+static void runi_gc_mark_words(struct runi_context *ctx, void **p, void **end) {
+    for (; p < end; p++)
+        runi_gc_mark(ctx, runi_gc_lookup(ctx, *p));
+}
+
+static void __attribute__((noinline)) runi_gc_mark_stack_words(struct runi_context *ctx) {
+    runi_gc_mark_words(ctx, __builtin_frame_address(0), runi_gc_stack_top(ctx));
+}
+
+static void runi_gc_sweep_chunk(struct runi_context *ctx, struct runi_arena *a, struct runi_chunk *c) {
+    struct runi_object *free_cells = NULL;
+    size_t live = 0;
+    for (char *cell = c->start; cell < c->bump; cell += c->cell_size) {
+        struct runi_object *obj = (struct runi_object *)cell;
+        if (obj->type && (obj->flags & RUNI_GC_MARK)) {
+            obj->flags &= ~RUNI_GC_MARK;
+            live++;
+            continue;
+        }
+        if (obj->type == RUNI_FUNCTION && obj->native)
+            runi_jit_retire(ctx, obj->native);
+        if (obj->type) {
+            obj->type = 0;
+            ctx->gc_stats.live_bytes -= c->cell_size;
+            ctx->gc_stats.live_objects--;
+            ctx->gc_stats.total_freed_bytes += c->cell_size;
+            ctx->gc_stats.total_freed_objects++;
+        }
+        obj->car = free_cells;
+        free_cells = obj;
+    }
+    c->live = live;
+    if (live == 0) {
+        c->bump = c->start;
+        return;
+    }
+    while (free_cells) {
+        struct runi_object *next = free_cells->car;
+        free_cells->car = a->free;
+        a->free = free_cells;
+        free_cells = next;
+    }
+}
+
+static void runi_gc_sweep(struct runi_context *ctx) {
+    for (size_t i = 0; i < RUNI_ARENA_CLASSES; i++) {
+        struct runi_arena *a = &ctx->arenas[i];
+        a->free = NULL;
+        a->cur = NULL;
+        for (struct runi_chunk *c = a->chunks; c; c = c->next) {
+            runi_gc_sweep_chunk(ctx, a, c);
+            if (!a->cur && c->bump < c->end)
+                a->cur = c;
+        }
+    }
+
+    for (struct runi_chunk **link = &ctx->large_objects; *link;) {
+        struct runi_chunk *c = *link;
+        struct runi_object *obj = (struct runi_object *)c->start;
+        if (obj->flags & RUNI_GC_MARK) {
+            obj->flags &= ~RUNI_GC_MARK;
+            link = &c->next;
+            continue;
+        }
+        *link = c->next;
+        ctx->gc_stats.live_bytes -= c->cell_size;
+        ctx->gc_stats.live_objects--;
+        ctx->gc_stats.total_freed_bytes += c->cell_size;
+        ctx->gc_stats.total_freed_objects++;
+        runi_chunk_release(ctx, c);
+    }
+}
+
+static void runi_gc_mark_roots(struct runi_context *ctx, struct runi_context *owner) {
+    for (size_t i = 0; i < owner->gc_roots_len; i++)
+        runi_gc_mark(ctx, *owner->gc_roots[i]);
+    for (size_t i = 0; i < owner->gc_ranges_len; i++)
+        for (size_t j = 0; j < *owner->gc_ranges[i].len; j++)
+            runi_gc_mark(ctx, runi_gc_lookup(ctx, (*owner->gc_ranges[i].base)[j]));
+    for (size_t i = 0; i < owner->vm_ncalls; i++)
+        runi_gc_mark(ctx, owner->vm_calls[i].code);
+}
+
+static void runi_gc_finish(struct runi_context *ctx) {
+    runi_gc_drain(ctx);
+    if (ctx->expansions_len) {
+        runi_gc_mark_expansions(ctx);
+        runi_gc_prune_expansions(ctx);
+    }
+    if (ctx->hcons)
+        runi_hashtable_prune(ctx->hcons, runi_gc_is_marked);
+    runi_gc_sweep(ctx);
+    ctx->gc_stats.collections++;
+}
+
+void runi_gc_collect(struct runi_context *ctx) {
+    jmp_buf regs;
+    setjmp(regs);
+
+    if (ctx->hcons)
+        runi_gc_hide_hcons(ctx);
+    for (size_t i = 0; i < ctx->symtab_cap; i++)
+        runi_gc_mark(ctx, ctx->symtab[i].sym);
+    runi_gc_mark_roots(ctx, ctx);
+    runi_gc_mark_stack_words(ctx);
+    runi_gc_finish(ctx);
+}
+
+void runi_gc_collect_children(struct runi_context *ctx, struct runi_context **children, int n) {
+    ctx->gc_children = children;
+    ctx->gc_nchildren = n;
+    if (ctx->hcons)
+        runi_gc_hide_hcons(ctx);
+    for (size_t i = 0; i < ctx->symtab_cap; i++)
+        runi_gc_mark(ctx, ctx->symtab[i].sym);
+    runi_gc_mark_roots(ctx, ctx);
+    for (int i = 0; i < n; i++) {
+        struct runi_context *child = children[i];
+        runi_gc_mark_roots(ctx, child);
+        runi_gc_mark(ctx, child->hcons);
+        for (size_t j = 0; j < child->expansions_cap; j++) {
+            runi_gc_mark(ctx, child->expansions[j].args);
+            runi_gc_mark(ctx, child->expansions[j].macro);
+            runi_gc_mark(ctx, child->expansions[j].expansion);
+        }
+        runi_gc_mark_words(ctx, child->stack_low, child->stack_top);
+    }
+    runi_gc_finish(ctx);
+    for (int i = 0; i < n; i++) {
+        struct runi_context *child = children[i];
+        size_t live = child->gc_stats.live_bytes;
+        runi_gc_sweep(child);
+        __atomic_sub_fetch(&ctx->child_bytes, live - child->gc_stats.live_bytes, __ATOMIC_RELAXED);
+    }
+    ctx->gc_children = NULL;
+    ctx->gc_nchildren = 0;
+}
+
+void runi_arena_trim(struct runi_context *ctx) {
+    for (size_t i = 0; i < RUNI_ARENA_CLASSES; i++) {
+        struct runi_arena *a = &ctx->arenas[i];
+        for (struct runi_chunk **link = &a->chunks; *link;) {
+            struct runi_chunk *c = *link;
+            if (c->bump != c->start) {
+                link = &c->next;
+                continue;
+            }
+            *link = c->next;
+            if (a->cur == c)
+                a->cur = NULL;
+            runi_chunk_release(ctx, c);
+        }
+    }
+}
+
+static struct runi_object *runi_arena_alloc(struct runi_context *ctx, struct runi_arena *a) {
+    struct runi_chunk *c = a->cur;
+    if (c && c->bump + a->cell_size <= c->end) {
+        struct runi_object *obj = (struct runi_object *)c->bump;
+        c->bump += a->cell_size;
+        return obj;
+    }
+    if (a->free) {
+        struct runi_object *obj = a->free;
+        a->free = obj->car;
+        return obj;
+    }
+    for (c = a->chunks; c; c = c->next)
+        if (c->bump + a->cell_size <= c->end)
+            break;
+    if (!c) {
+        c = runi_chunk_new(ctx, a->cell_size, RUNI_ARENA_CHUNK_SIZE / a->cell_size * a->cell_size);
+        c->next = a->chunks;
+        a->chunks = c;
+        runi_chunk_register(ctx, c);
+    }
+    a->cur = c;
+    struct runi_object *obj = (struct runi_object *)c->bump;
+    c->bump += a->cell_size;
+    return obj;
+}
+
+static bool runi_child_reserve(struct runi_context *ctx, size_t size) {
+    struct runi_context *p = ctx->parent;
+    if (p->gc_stats.live_bytes + __atomic_add_fetch(&p->child_bytes, size, __ATOMIC_RELAXED) <= ctx->gc_stats.heap_size)
+        return true;
+    __atomic_sub_fetch(&p->child_bytes, size, __ATOMIC_RELAXED);
+    return false;
+}
+
+static struct runi_object *runi_alloc(struct runi_context *ctx, int type, size_t size) {
+    size += offsetof(struct runi_object, car);
+    size = (size + RUNI_ARENA_GRANULE - 1) & ~(size_t)(RUNI_ARENA_GRANULE - 1);
+    if (size < 2 * RUNI_ARENA_GRANULE)
+        size = 2 * RUNI_ARENA_GRANULE;
+    if (ctx->parent) {
+        if (!runi_child_reserve(ctx, size)) {
+            runi_par_safepoint(ctx);
+            if (!runi_child_reserve(ctx, size))
+                runi_error(ctx, "Memory exhausted");
+        }
+    } else if (!ctx->gc_inhibit && ctx->gc_stats.live_bytes + size > ctx->gc_stats.heap_size) {
+        runi_gc_collect(ctx);
+        if (ctx->gc_stats.live_bytes + size > ctx->gc_stats.heap_size)
+            runi_error(ctx, "Memory exhausted");
+    }
+
+    struct runi_object *obj;
+    if (size <= RUNI_ARENA_MAX_SMALL) {
+        struct runi_arena *a = &ctx->arenas[size / RUNI_ARENA_GRANULE];
+        a->cell_size = size;
+        obj = runi_arena_alloc(ctx, a);
+    } else {
+        struct runi_chunk *c = runi_chunk_new(ctx, size, size);
+        c->bump = c->end;
+        c->next = ctx->large_objects;
+        ctx->large_objects = c;
+        runi_chunk_register(ctx, c);
+        obj = (struct runi_object *)c->start;
+    }
+    ctx->gc_stats.live_bytes += size;
+    ctx->gc_stats.live_objects++;
+    ctx->gc_stats.total_allocated_bytes += size;
+    ctx->gc_stats.total_allocated_objects++;
+    RUNI_STAT(ctx->stats.alloc_objects[type]++; ctx->stats.alloc_bytes[type] += size);
     obj->type = type;
+    obj->flags = 0;
     return obj;
 }
 
-struct runi_object *runi_make_integer(int integer) {
-    struct runi_object *r = runi_alloc(RUNI_INTEGER, sizeof(int));
-    r->integer = integer;
-    return r;
+struct runi_object *runi_make_integer(struct runi_context *ctx, int64_t integer) {
+    if (integer < RUNI_FIXNUM_MIN || integer > RUNI_FIXNUM_MAX)
+        runi_error(ctx, "Integer overflow");
+    return runi_fixnum(integer);
 }
 
-struct runi_object *runi_make_symbol(char *name) {
-    struct runi_object *sym = runi_alloc(RUNI_SYMBOL, strlen(name) + 1);
-    strcpy(sym->name, name);
+struct runi_object *runi_make_symbol(struct runi_context *ctx, const char *name, size_t len) {
+    struct runi_object *sym = runi_alloc(ctx, RUNI_SYMBOL, offsetof(struct runi_object, name) - offsetof(struct runi_object, value) + len + 1);
+    sym->value = NULL;
+    memcpy(sym->name, name, len);
+    sym->name[len] = '\0';
     return sym;
 }
 
-struct runi_object *runi_make_string(char *string) {
-    struct runi_object *str = runi_alloc(RUNI_STRING, strlen(string) + 1);
-    strcpy(str->string, string);
+static struct runi_object *runi_alloc_string(struct runi_context *ctx, size_t len) {
+    struct runi_object *str = runi_alloc(ctx, RUNI_STRING, offsetof(struct runi_object, bytes) - offsetof(struct runi_object, chars) + len + 1);
+    str->bytes[len] = '\0';
+    str->chars = str->bytes;
+    str->nchars = len;
+    str->base = NULL;
+    return str;
+}
+
+struct runi_object *runi_make_string_len(struct runi_context *ctx, const char *string, size_t len) {
+    struct runi_object *str = runi_alloc_string(ctx, len);
+    memcpy(str->bytes, string, len);
     return str;
 }
 
-struct runi_object *runi_make_primitive(runi_primitive *fn) {
-    struct runi_object *r = runi_alloc(RUNI_PRIMITIVE, sizeof(runi_primitive *));
+struct runi_object *runi_make_string(struct runi_context *ctx, char *string) {
+    return runi_make_string_len(ctx, string, strlen(string));
+}
+
+struct runi_object *runi_make_substring(struct runi_context *ctx, struct runi_object *str, size_t start, size_t end) {
+    assert(start <= end && end <= str->nchars);
+    if (start == 0 && end == str->nchars)
+        return str;
+    struct runi_object *r = runi_alloc(ctx, RUNI_STRING, offsetof(struct runi_object, bytes) - offsetof(struct runi_object, chars));
+    r->chars = str->chars + start;
+    r->nchars = end - start;
+    r->base = str->base ? str->base : str;
+    return r;
+}
+
+const char *runi_string_cstr(struct runi_context *ctx, struct runi_object *str) {
+    struct runi_object *base = str->base ? str->base : str;
+    if (str->chars + str->nchars == base->bytes + base->nchars)
+        return str->chars;
+    return runi_make_string_len(ctx, str->chars, str->nchars)->chars;
+}
+
+struct runi_object *runi_make_primitive(struct runi_context *ctx, runi_primitive *fn) {
+    struct runi_object *r = runi_alloc(ctx, RUNI_PRIMITIVE, offsetof(struct runi_object, max_args) - offsetof(struct runi_object, fn) + sizeof(int));
     r->fn = fn;
+    r->ncalls = 0;
+    r->afn = NULL;
+    return r;
+}
+
+struct runi_object *runi_make_argv_primitive(struct runi_context *ctx, const char *name, runi_argv_primitive *fn, int min_args, int max_args) {
+    struct runi_object *r = runi_make_primitive(ctx, NULL);
+    r->afn = fn;
+    r->pname = name;
+    r->min_args = min_args;
+    r->max_args = max_args;
     return r;
 }
 
-struct runi_object *runi_make_function(int type, struct runi_object *env, struct runi_object *args, struct runi_object *body) {
+struct runi_object *runi_make_function(struct runi_context *ctx, int type, struct runi_object *env, struct runi_object *args, struct runi_object *body) {
     assert(type == RUNI_FUNCTION || type == RUNI_MACRO);
-    struct runi_object *r = runi_alloc(type, sizeof(struct runi_object *) * 3);
+    struct runi_object *r = runi_alloc(ctx, type, offsetof(struct runi_object, calls) - offsetof(struct runi_object, env) + sizeof(long));
     r->env = env;
     r->args = args;
     r->body = body;
+    r->code = NULL;
+    r->fname = NULL;
+    r->source = NULL;
+    r->deps = runi_nil;
+    r->memo = NULL;
+    r->depoch = 0;
+    r->native = NULL;
+    r->calls = 0;
+    return r;
+}
+
+struct runi_object *runi_make_frame(struct runi_context *ctx, struct runi_object *parent, struct runi_object *params, size_t nslots) {
+    struct runi_object *r = runi_alloc(ctx, RUNI_FRAME, offsetof(struct runi_object, slots) - offsetof(struct runi_object, vars)
+                                       + sizeof(struct runi_object *) * nslots);
+    r->vars = runi_nil;
+    r->parent = parent;
+    r->params = params;
+    r->nslots = nslots;
+    for (size_t i = 0; i < nslots; i++)
+        r->slots[i] = runi_nil;
+    return r;
+}
+
+struct runi_object *runi_make_vector(struct runi_context *ctx, size_t nitems, struct runi_object *fill) {
+    struct runi_object *r = runi_alloc(ctx, RUNI_VECTOR, offsetof(struct runi_object, items) - offsetof(struct runi_object, nitems)
+                                       + sizeof(struct runi_object *) * nitems);
+    r->nitems = nitems;
+    for (size_t i = 0; i < nitems; i++)
+        r->items[i] = fill;
+    return r;
+}
+
+struct runi_object *runi_make_hashtable(struct runi_context *ctx, int test) {
+    struct runi_object *r = runi_alloc(ctx, RUNI_HASHTABLE, offsetof(struct runi_object, htest) - offsetof(struct runi_object, buckets) + sizeof(int));
+    r->buckets = NULL;
+    r->old_buckets = NULL;
+    r->hcount = 0;
+    r->hused = 0;
+    r->hmigrated = 0;
+    r->htest = test;
+    r->buckets = runi_make_vector(ctx, RUNI_HASH_MIN_CAP * 2, NULL);
     return r;
 }
 
-struct runi_object *runi_make_special(int type) {
-    struct runi_object *r = malloc(sizeof(void *) * 2);
-    r->type = type;
+struct runi_object *runi_make_localref(struct runi_context *ctx, struct runi_object *symbol, int depth, int index) {
+    struct runi_object *r = runi_alloc(ctx, RUNI_LOCALREF, sizeof(struct runi_object *) + sizeof(int) * 2);
+    r->symbol = symbol;
+    r->depth = depth;
+    r->index = index;
     return r;
 }
 
-struct runi_object *runi_make_env(struct runi_object *vars, struct runi_object *parent) {
-    struct runi_object *r = runi_alloc(RUNI_ENV, sizeof(struct runi_object *) * 2);
+struct runi_object *runi_make_globalref(struct runi_context *ctx, struct runi_object *symbol) {
+    struct runi_object *r = runi_alloc(ctx, RUNI_GLOBALREF, offsetof(struct runi_object, epoch) - offsetof(struct runi_object, symbol) + sizeof(unsigned long));
+    r->symbol = symbol;
+    r->cache = NULL;
+    r->epoch = 0;
+    return r;
+}
+
+struct runi_object *runi_make_code(struct runi_context *ctx, int ncode, int nconsts, int nstack, int nparams) {
+    struct runi_object *r = runi_alloc(ctx, RUNI_CODE, offsetof(struct runi_object, consts) - offsetof(struct runi_object, ncode)
+                                       + sizeof(struct runi_object *) * nconsts + sizeof(int32_t) * ncode);
+    r->ncode = ncode;
+    r->nconsts = nconsts;
+    r->nstack = nstack;
+    r->nparams = nparams;
+    for (int i = 0; i < nconsts; i++)
+        r->consts[i] = runi_nil;
+    return r;
+}
+
+int32_t *runi_code_ops(struct runi_object *code) {
+    return (int32_t *)&code->consts[code->nconsts];
+}
+
+struct runi_object *runi_make_env(struct runi_context *ctx, struct runi_object *vars, struct runi_object *parent) {
+    struct runi_object *r = runi_alloc(ctx, RUNI_ENV, sizeof(struct runi_object *) * 2);
     r->vars = vars;
     r->parent = parent;
     return r;
 }
 
-struct runi_object *runi_cons(struct runi_object *car, struct runi_object *cdr) {
-    struct runi_object *cell = runi_alloc(RUNI_LIST, sizeof(struct runi_object *) * 2);
+struct runi_object *runi_cons(struct runi_context *ctx, struct runi_object *car, struct runi_object *cdr) {
+    struct runi_object *cell = runi_alloc(ctx, RUNI_LIST, sizeof(struct runi_object *) * 2);
     cell->car = car;
     cell->cdr = cdr;
     return cell;
 }
 
-struct runi_object *runi_acons(struct runi_object *x, struct runi_object *y, struct runi_object *a) {
-    return runi_cons(runi_cons(x, y), a);
+struct runi_object *runi_acons(struct runi_context *ctx, struct runi_object *x, struct runi_object *y, struct runi_object *a) {
+    return runi_cons(ctx, runi_cons(ctx, x, y), a);
+}
+
+static uint32_t runi_symbol_hash(const char *name, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void runi_symtab_grow(struct runi_context *ctx, struct runi_context *owner) {
+    size_t cap = owner->symtab_cap ? owner->symtab_cap * 2 : 256;
+    struct runi_symtab_entry *table = calloc(cap, sizeof(*table));
+    if (!table)
+        runi_error(ctx, "Memory exhausted");
+    for (size_t i = 0; i < owner->symtab_cap; i++) {
+        struct runi_symtab_entry *e = &owner->symtab[i];
+        if (!e->sym)
+            continue;
+        size_t j = e->hash & (cap - 1);
+        while (table[j].sym)
+            j = (j + 1) & (cap - 1);
+        table[j] = *e;
+    }
+    free(owner->symtab);
+    owner->symtab = table;
+    owner->symtab_cap = cap;
+}
+
+static struct runi_object *runi_symtab_intern(struct runi_context *ctx, struct runi_context *owner, const char *name, size_t len) {
+    if ((owner->symtab_len + 1) * 2 > owner->symtab_cap)
+        runi_symtab_grow(ctx, owner);
+    uint32_t hash = runi_symbol_hash(name, len);
+    size_t mask = owner->symtab_cap - 1;
+    size_t i = hash & mask;
+    for (; owner->symtab[i].sym; i = (i + 1) & mask) {
+        struct runi_symtab_entry *e = &owner->symtab[i];
+        if (e->hash == hash && e->len == len && memcmp(e->sym->name, name, len) == 0)
+            return e->sym;
+    }
+    struct runi_object *sym = runi_make_symbol(ctx, name, len);
+    owner->symtab[i].hash = hash;
+    owner->symtab[i].len = len;
+    owner->symtab[i].sym = sym;
+    owner->symtab_len++;
+    return sym;
+}
+
+struct runi_object *runi_intern_len(struct runi_context *ctx, const char *name, size_t len) {
+    if (!ctx->parent)
+        return runi_symtab_intern(ctx, ctx, name, len);
+    struct runi_handler handler;
+    if (setjmp(handler.buf)) {
+        char msg[sizeof(ctx->error)];
+        snprintf(msg, sizeof(msg), "%s", ctx->error);
+        pthread_mutex_unlock(&ctx->parent->symtab_lock);
+        runi_error(ctx, "%s", msg);
+    }
+    runi_par_lock(ctx, &ctx->parent->symtab_lock);
+    runi_push_handler(ctx, &handler);
+    struct runi_object *sym = runi_symtab_intern(ctx, ctx->parent, name, len);
+    runi_pop_handler(ctx, &handler);
+    pthread_mutex_unlock(&ctx->parent->symtab_lock);
+    return sym;
+}
+
+struct runi_object *runi_intern(struct runi_context *ctx, char *name) {
+    return runi_intern_len(ctx, name, strlen(name));
+}
+
+void runi_reader_init_buffer(struct runi_reader *r, const char *buf, size_t len) {
+    memset(r, 0, sizeof(*r));
+    r->buf = buf;
+    r->len = len;
+    r->fd = -1;
+}
+
+void runi_reader_init_fd(struct runi_reader *r, int fd) {
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+}
+
+bool runi_reader_open_file(struct runi_reader *r, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    runi_reader_init_buffer(r, NULL, st.st_size);
+    if (st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            runi_reader_init_fd(r, fd);
+            r->owns_fd = true;
+            return true;
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        r->buf = map;
+        r->map = map;
+    }
+    close(fd);
+    return true;
+}
+
+void runi_reader_close(struct runi_reader *r) {
+    if (r->map)
+        munmap(r->map, r->len);
+    if (r->owns_fd)
+        close(r->fd);
+    free(r->data);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+static bool runi_reader_fill(struct runi_context *ctx, struct runi_reader *r) {
+    if (r->fd < 0)
+        return false;
+    size_t keep = r->len - r->start;
+    if (r->start > 0)
+        memmove(r->data, r->data + r->start, keep);
+    r->pos -= r->start;
+    r->len = keep;
+    r->start = 0;
+    if (r->len == r->cap) {
+        r->cap = r->cap ? r->cap * 2 : RUNI_READER_BUFSIZE;
+        r->data = realloc(r->data, r->cap);
+        if (!r->data)
+            runi_error(ctx, "Memory exhausted");
+    }
+    r->buf = r->data;
+    ssize_t n;
+    do
+        n = read(r->fd, r->data + r->len, r->cap - r->len);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0)
+        return false;
+    r->len += n;
+    return true;
+}
+
+static int runi_reader_peek(struct runi_context *ctx, struct runi_reader *r) {
+    if (r->pos == r->len && !runi_reader_fill(ctx, r))
+        return EOF;
+    return (unsigned char)r->buf[r->pos];
 }
 
-static int runi_peek(void) {
-    int c = getchar();
-    ungetc(c, stdin);
+static int runi_reader_next(struct runi_context *ctx, struct runi_reader *r) {
+    int c = runi_reader_peek(ctx, r);
+    if (c != EOF)
+        r->pos++;
     return c;
 }
 
-static void skip_line(void) {
+static void skip_line(struct runi_context *ctx, struct runi_reader *r) {
     for (;;) {
-        int c = getchar();
-        if (c == EOF || c == '\n')
-            return;
-        if (c == '\r') {
-            if (runi_peek() == '\n')
-                getchar();
+        const char *nl = memchr(r->buf + r->pos, '\n', r->len - r->pos);
+        if (nl) {
+            r->pos = nl - r->buf + 1;
             return;
         }
+        r->pos = r->start = r->len;
+        if (!runi_reader_fill(ctx, r))
+            return;
     }
 }
 
-static struct runi_object *parse_list(void) {
-    struct runi_object *obj = runi_parse();
+static struct runi_object *parse_list(struct runi_context *ctx, struct runi_reader *r) {
+    struct runi_object *obj = runi_read(ctx, r);
     if (!obj)
-        runi_error("Unclosed parenthesis");
+        runi_error(ctx, "Unclosed parenthesis");
     if (obj == runi_dot)
-        runi_error("Stray dot");
+        runi_error(ctx, "Stray dot");
     if (obj == runi_cparen)
         return runi_nil;
     struct runi_object *head, *tail;
-    head = tail = runi_cons(obj, runi_nil);
+    head = tail = runi_cons(ctx, obj, runi_nil);
 
     for (;;) {
-        struct runi_object *obj = runi_parse();
+        struct runi_object *obj = runi_read(ctx, r);
         if (!obj)
-            runi_error("Unclosed parenthesis");
+            runi_error(ctx, "Unclosed parenthesis");
         if (obj == runi_cparen)
             return head;
         if (obj == runi_dot) {
-            tail->cdr = runi_parse();
-            if (runi_parse() != runi_cparen)
-                runi_error("Closed parenthesis expected after dot");
+            tail->cdr = runi_read(ctx, r);
+            if (runi_read(ctx, r) != runi_cparen)
+                runi_error(ctx, "Closed parenthesis expected after dot");
             return head;
         }
-        tail->cdr = runi_cons(obj, runi_nil);
+        tail->cdr = runi_cons(ctx, obj, runi_nil);
         tail = tail->cdr;
     }
 }
 
-struct runi_object *runi_intern(char *name) {
-    for (struct runi_object *p = runi_symbols; p != runi_nil; p = p->cdr)
-        if (strcmp(name, p->car->name) == 0)
-            return p->car;
-    struct runi_object *sym = runi_make_symbol(name);
-    runi_symbols = runi_cons(sym, runi_symbols);
-    return sym;
+static struct runi_object *parse_vector(struct runi_context *ctx, struct runi_reader *r) {
+    struct runi_object *list = parse_list(ctx, r);
+    int n = runi_list_length(ctx, list);
+    if (n < 0)
+        runi_error(ctx, "Dotted vector literal");
+    struct runi_object *v = runi_make_vector(ctx, n, runi_nil);
+    for (int i = 0; i < n; i++, list = list->cdr)
+        v->items[i] = list->car;
+    return v;
 }
 
-static struct runi_object *parse_quote(void) {
-    struct runi_object *sym = runi_intern("quote");
-    return runi_cons(sym, runi_cons(runi_parse(), runi_nil));
+static struct runi_object *parse_quote(struct runi_context *ctx, struct runi_reader *r) {
+    struct runi_object *sym = runi_intern(ctx, "quote");
+    return runi_cons(ctx, sym, runi_cons(ctx, runi_read(ctx, r), runi_nil));
 }
 
-static int parse_number(int val) {
-    while (isdigit(runi_peek()))
-        val = val * 10 + (getchar() - '0');
+static int64_t parse_number(struct runi_context *ctx, struct runi_reader *r, int64_t val) {
+    while (isdigit(runi_reader_peek(ctx, r))) {
+        int d = r->buf[r->pos++] - '0';
+        if (val > (RUNI_FIXNUM_MAX - d) / 10)
+            runi_error(ctx, "Integer too large");
+        val = val * 10 + d;
+    }
     return val;
 }
 
-static struct runi_object *parse_symbol(char c) {
-    char buf[RUNI_SYMBOL_MAX_LEN + 1];
-    int len = 1;
-    buf[0] = c;
-    while (isalnum(runi_peek()) || runi_peek() == '-') {
-        if (RUNI_SYMBOL_MAX_LEN <= len)
-            runi_error("Symbol name too long");
-        buf[len++] = getchar();
+static struct runi_object *parse_symbol(struct runi_context *ctx, struct runi_reader *r) {
+    r->start = r->pos - 1;
+    for (;;) {
+        int c = runi_reader_peek(ctx, r);
+        if (!isalnum(c) && !(c && strchr("+-<=>!?@#$%^&*_/", c)))
+            break;
+        r->pos++;
     }
-    buf[len] = '\0';
-    return runi_intern(buf);
+    return runi_intern_len(ctx, r->buf + r->start, r->pos - r->start);
 }
 
-static char runi_parse_string_backslash(char c) {
-    if (getchar() != '\\')
-        runi_error("Malformed runi_parse_string_backslash");
-
-    c = getchar();
-
-    switch (c) {
+static char runi_parse_string_backslash(struct runi_context *ctx, struct runi_reader *r) {
+    switch (runi_reader_next(ctx, r)) {
         case 'n':
             return '\n';
         case 'r':
             return '\r';
         default:
-            runi_error("Unkown backslash character");
+            runi_error(ctx, "Unkown backslash character");
     }
 }
 
-static struct runi_object *runi_parse_string(char c) {
-    char buf[RUNI_SYMBOL_MAX_LEN + 1];
-    int len = 0;
-    while (runi_peek() != '"') {
-        if (RUNI_SYMBOL_MAX_LEN <= len)
-            runi_error("String too long");
-        if (runi_peek() == '\\'){
-            buf[len++] = runi_parse_string_backslash(c);
+static void runi_string_append(struct runi_context *ctx, char **buf, size_t *len, size_t *cap, const char *s, size_t n) {
+    if (*len + n > *cap) {
+        while (*len + n > *cap)
+            *cap = *cap ? *cap * 2 : 64;
+        *buf = realloc(*buf, *cap);
+        if (!*buf)
+            runi_error(ctx, "Memory exhausted");
+    }
+    memcpy(*buf + *len, s, n);
+    *len += n;
+}
+
+static struct runi_object *runi_parse_string(struct runi_context *ctx, struct runi_reader *r) {
+    char *buf = NULL;
+    size_t len = 0, cap = 0;
+    r->start = r->pos;
+    for (;;) {
+        int c = runi_reader_peek(ctx, r);
+        if (c == EOF)
+            runi_error(ctx, "Unclosed string");
+        if (c != '"' && c != '\\') {
+            r->pos++;
             continue;
         }
-        buf[len++] = getchar();
+        if (c == '"' && !buf) {
+            struct runi_object *str = runi_make_string_len(ctx, r->buf + r->start, r->pos - r->start);
+            r->pos++;
+            return str;
+        }
+        runi_string_append(ctx, &buf, &len, &cap, r->buf + r->start, r->pos - r->start);
+        r->pos++;
+        if (c == '"') {
+            struct runi_object *str = runi_make_string_len(ctx, buf, len);
+            free(buf);
+            return str;
+        }
+        r->start = r->pos;
+        char e = runi_parse_string_backslash(ctx, r);
+        runi_string_append(ctx, &buf, &len, &cap, &e, 1);
+        r->start = r->pos;
     }
-    getchar();
-    buf[len] = '\0';
-    return runi_make_string(buf);
 }
 
-struct runi_object *runi_parse(void) {
+struct runi_object *runi_read(struct runi_context *ctx, struct runi_reader *r) {
     for (;;) {
-        int c = getchar();
+        r->start = r->pos;
+        int c = runi_reader_next(ctx, r);
         if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
             continue;
         if (c == EOF)
             return NULL;
         if (c == ';') {
-            skip_line();
+            skip_line(ctx, r);
             continue;
         }
         if (c == '(')
-            return parse_list();
+            return parse_list(ctx, r);
         if (c == ')')
             return runi_cparen;
         if (c == '.')
             return runi_dot;
         if (c == '\'')
-            return parse_quote();
+            return parse_quote(ctx, r);
         if (isdigit(c))
-            return runi_make_integer(parse_number(c - '0'));
-        if (c == '-')
-            return runi_make_integer(-parse_number(0));
-        if (isalpha(c) || strchr("+=!@#$%^&*", c))
-            return parse_symbol(c);
+            return runi_make_integer(ctx, parse_number(ctx, r, c - '0'));
+        if (c == '-' && isdigit(runi_reader_peek(ctx, r)))
+            return runi_make_integer(ctx, -parse_number(ctx, r, 0));
+        if (c == '#' && runi_reader_peek(ctx, r) == '(') {
+            r->pos++;
+            return parse_vector(ctx, r);
+        }
+        if (isalpha(c) || (c && strchr("+-<=!@#$%^&*", c)))
+            return parse_symbol(ctx, r);
         if (c == '"')
-            return runi_parse_string(c);
-        runi_error("Don't know how to handle %c", c);
+            return runi_parse_string(ctx, r);
+        runi_error(ctx, "Don't know how to handle %c", c);
+    }
+}
+
+struct runi_object *runi_parse(struct runi_context *ctx) {
+    return runi_read(ctx, &ctx->input);
+}
+
+struct runi_print_buffer {
+    char *buf;
+    size_t len;
+    size_t cap;
+};
+
+static void runi_print_write(struct runi_context *ctx, struct runi_print_buffer *out, const char *s, size_t n) {
+    if (out->len + n + 1 > out->cap) {
+        while (out->len + n + 1 > out->cap)
+            out->cap = out->cap ? out->cap * 2 : 256;
+        out->buf = realloc(out->buf, out->cap);
+        if (!out->buf)
+            runi_error(ctx, "Memory exhausted");
     }
+    memcpy(out->buf + out->len, s, n);
+    out->len += n;
+    out->buf[out->len] = '\0';
+}
+
+static void runi_print_puts(struct runi_context *ctx, struct runi_print_buffer *out, const char *s) {
+    runi_print_write(ctx, out, s, strlen(s));
 }
 
-void runi_print(struct runi_object *obj) {
-    switch (obj->type) {
+static void runi_print_atom(struct runi_context *ctx, struct runi_print_buffer *out, struct runi_object *obj) {
+    char num[24];
+    switch (runi_type(obj)) {
     case RUNI_INTEGER:
-        printf("%d", obj->integer);
-        return;
-    case RUNI_LIST:
-        printf("(");
-        for (;;) {
-            runi_print(obj->car);
-            if (obj->cdr == runi_nil)
-                break;
-            if (obj->cdr->type != RUNI_LIST) {
-                printf(" . ");
-                runi_print(obj->cdr);
-                break;
-            }
-            printf(" ");
-            obj = obj->cdr;
-        }
-        printf(")");
+        runi_print_write(ctx, out, num, snprintf(num, sizeof(num), "%lld", (long long)runi_fixnum_value(obj)));
         return;
     case RUNI_SYMBOL:
-        printf("%s", obj->name);
+        runi_print_puts(ctx, out, obj->name);
+        return;
+    case RUNI_LOCALREF:
+    case RUNI_GLOBALREF:
+        runi_print_puts(ctx, out, obj->symbol->name);
         return;
     case RUNI_STRING:
-        printf("%s", obj->string);
+        runi_print_write(ctx, out, obj->chars, obj->nchars);
         return;
     case RUNI_PRIMITIVE:
-        printf("<primitive>");
+        runi_print_puts(ctx, out, "<primitive>");
         return;
     case RUNI_FUNCTION:
-        printf("<function>");
+        runi_print_puts(ctx, out, "<function>");
         return;
     case RUNI_MACRO:
-        printf("<macro>");
+        runi_print_puts(ctx, out, "<macro>");
+        return;
+    case RUNI_HASHTABLE:
+        runi_print_puts(ctx, out, "<hashtable>");
         return;
     case RUNI_NIL:
     case RUNI_TRUE:
         if (obj == runi_nil)
-            printf("()");
+            runi_print_puts(ctx, out, "()");
         else if (obj == runi_true)
-            printf("t");
+            runi_print_puts(ctx, out, "t");
         return;
     default:
-        runi_error("Bug: print: Unknown tag type: %d", obj->type);
+        runi_error(ctx, "Bug: print: Unknown tag type: %d", runi_type(obj));
     }
 }
 
-void runi_add_variable(struct runi_object *env, struct runi_object *sym, struct runi_object *val) {
-    env->vars = runi_acons(sym, val, env->vars);
-}
+enum {
+    RUNI_PRINT_OBJECT,
+    RUNI_PRINT_REST,
+    RUNI_PRINT_CLOSE,
+    RUNI_PRINT_VECTOR,
+};
 
-int runi_list_length(struct runi_object *list) {
-    int len = 0;
-    for (;;) {
-        if (list == runi_nil)
-            return len;
-        if (list->type != RUNI_LIST)
-            runi_error("length: cannot handle dotted list");
-        list = list->cdr;
-        len++;
+struct runi_print_task {
+    int kind;
+    struct runi_object *obj;
+    size_t index;
+};
+
+static void runi_print_object(struct runi_context *ctx, struct runi_print_buffer *out, struct runi_object *obj) {
+    struct runi_print_task *stack = NULL;
+    size_t len = 0, cap = 0;
+#define PUSH(k, o, i) do { \
+        if (len == cap) { \
+            cap = cap ? cap * 2 : 64; \
+            stack = realloc(stack, sizeof(*stack) * cap); \
+            if (!stack) \
+                runi_error(ctx, "Memory exhausted"); \
+        } \
+        stack[len].kind = (k); \
+        stack[len].obj = (o); \
+        stack[len].index = (i); \
+        len++; \
+    } while (0)
+
+    runi_print_write(ctx, out, "", 0);
+    PUSH(RUNI_PRINT_OBJECT, obj, 0);
+    while (len) {
+        struct runi_print_task task = stack[--len];
+        switch (task.kind) {
+        case RUNI_PRINT_OBJECT:
+            if (runi_type(task.obj) == RUNI_VECTOR) {
+                runi_print_write(ctx, out, "#(", 2);
+                PUSH(RUNI_PRINT_VECTOR, task.obj, 0);
+                break;
+            }
+            if (runi_type(task.obj) != RUNI_LIST) {
+                runi_print_atom(ctx, out, task.obj);
+                break;
+            }
+            runi_print_write(ctx, out, "(", 1);
+            PUSH(RUNI_PRINT_REST, task.obj, 0);
+            PUSH(RUNI_PRINT_OBJECT, task.obj->car, 0);
+            break;
+        case RUNI_PRINT_REST: {
+            struct runi_object *cdr = task.obj->cdr;
+            if (cdr == runi_nil) {
+                runi_print_write(ctx, out, ")", 1);
+            } else if (runi_type(cdr) != RUNI_LIST) {
+                runi_print_write(ctx, out, " . ", 3);
+                PUSH(RUNI_PRINT_CLOSE, NULL, 0);
+                PUSH(RUNI_PRINT_OBJECT, cdr, 0);
+            } else {
+                runi_print_write(ctx, out, " ", 1);
+                PUSH(RUNI_PRINT_REST, cdr, 0);
+                PUSH(RUNI_PRINT_OBJECT, cdr->car, 0);
+            }
+            break;
+        }
+        case RUNI_PRINT_CLOSE:
+            runi_print_write(ctx, out, ")", 1);
+            break;
+        case RUNI_PRINT_VECTOR:
+            if (task.index == task.obj->nitems) {
+                runi_print_write(ctx, out, ")", 1);
+                break;
+            }
+            if (task.index)
+                runi_print_write(ctx, out, " ", 1);
+            PUSH(RUNI_PRINT_VECTOR, task.obj, task.index + 1);
+            PUSH(RUNI_PRINT_OBJECT, task.obj->items[task.index], 0);
+            break;
+        }
     }
+#undef PUSH
+    free(stack);
 }
 
-static struct runi_object *runi_push_env(struct runi_object *env, struct runi_object *vars, struct runi_object *values) {
-    if (runi_list_length(vars) != runi_list_length(values))
-        runi_error("Cannot apply function: number of argument does not match");
-    struct runi_object *map = runi_nil;
-    for (struct runi_object *p = vars, *q = values; p != runi_nil; p = p->cdr, q = q->cdr) {
-        struct runi_object *sym = p->car;
-        struct runi_object *val = q->car;
-        map = runi_acons(sym, val, map);
-    }
-    return runi_make_env(map, env);
+void runi_print_to(struct runi_context *ctx, struct runi_object *obj, runi_print_sink *sink, void *data) {
+    struct runi_print_buffer out = { NULL, 0, 0 };
+    runi_print_object(ctx, &out, obj);
+    sink(data, out.buf, out.len);
+    free(out.buf);
 }
 
-struct runi_object *runi_progn(struct runi_object *env, struct runi_object *list) {
-    struct runi_object *r = NULL;
-    for (struct runi_object *lp = list; lp != runi_nil; lp = lp->cdr)
-        r = runi_eval(env, lp->car);
-    return r;
+char *runi_print_to_string(struct runi_context *ctx, struct runi_object *obj, size_t *len) {
+    struct runi_print_buffer out = { NULL, 0, 0 };
+    runi_print_object(ctx, &out, obj);
+    if (len)
+        *len = out.len;
+    return out.buf;
 }
 
-struct runi_object *runi_eval_list(struct runi_object *env, struct runi_object *list) {
-    struct runi_object *head = NULL;
-    struct runi_object *tail = NULL;
-    for (struct runi_object *lp = list; lp != runi_nil; lp = lp->cdr) {
-        struct runi_object *tmp = runi_eval(env, lp->car);
-        if (head == NULL) {
-            head = tail = runi_cons(tmp, runi_nil);
-        } else {
-            tail->cdr = runi_cons(tmp, runi_nil);
-            tail = tail->cdr;
-        }
-    }
-    if (head == NULL)
-        return runi_nil;
+static void runi_print_file_sink(void *data, const char *buf, size_t len) {
+    fwrite(buf, 1, len, data);
+}
+
+void runi_print(struct runi_context *ctx, struct runi_object *obj) {
+    runi_print_to(ctx, obj, ctx->output, ctx->output_data);
+}
+
+static bool runi_is_callable(struct runi_object *obj) {
+    return obj && (runi_type(obj) == RUNI_PRIMITIVE || runi_type(obj) == RUNI_FUNCTION || runi_type(obj) == RUNI_MACRO);
+}
+
+static bool runi_is_global_env(struct runi_object *env) {
+    return runi_type(env) == RUNI_ENV && env->parent == NULL;
+}
+
+static void runi_set_slot(struct runi_context *ctx, struct runi_object **slot, struct runi_object *val) {
+    if (runi_is_callable(*slot) || runi_is_callable(val))
+        ctx->global_epoch++;
+    *slot = val;
+}
+
+void runi_add_variable(struct runi_context *ctx, struct runi_object *env, struct runi_object *sym, struct runi_object *val) {
+    if (runi_is_global_env(env)) {
+        runi_set_slot(ctx, &sym->value, val);
+        return;
+    }
+    ctx->global_epoch++;
+    if (runi_type(env) == RUNI_FRAME) {
+        size_t i = 0;
+        for (struct runi_object *p = env->params; p != runi_nil; p = p->cdr, i++) {
+            if (p->car == sym) {
+                env->slots[i] = val;
+                return;
+            }
+        }
+    }
+    env->vars = runi_acons(ctx, sym, val, env->vars);
+}
+
+int runi_list_length(struct runi_context *ctx, struct runi_object *list) {
+    int len = 0;
+    for (;;) {
+        if (list == runi_nil)
+            return len;
+        if (runi_type(list) != RUNI_LIST)
+            runi_error(ctx, "length: cannot handle dotted list");
+        list = list->cdr;
+        len++;
+    }
+}
+
+static struct runi_object *runi_push_frame(struct runi_context *ctx, struct runi_object *env, struct runi_object *params, struct runi_object *values) {
+    int nslots = runi_list_length(ctx, params);
+    if (nslots != runi_list_length(ctx, values))
+        runi_error(ctx, "Cannot apply function: number of argument does not match");
+    struct runi_object *frame = runi_make_frame(ctx, env, params, nslots);
+    for (int i = 0; i < nslots; i++, values = values->cdr)
+        frame->slots[i] = values->car;
+    return frame;
+}
+
+static struct runi_object *runi_progn_tail(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    if (list == runi_nil)
+        return runi_nil;
+    for (; list->cdr != runi_nil; list = list->cdr)
+        runi_eval(ctx, env, list->car);
+    return list->car;
+}
+
+struct runi_object *runi_progn(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    struct runi_object *r = NULL;
+    for (struct runi_object *lp = list; lp != runi_nil; lp = lp->cdr)
+        r = runi_eval(ctx, env, lp->car);
+    return r;
+}
+
+struct runi_object *runi_eval_list(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    struct runi_object *head = NULL;
+    struct runi_object *tail = NULL;
+    for (struct runi_object *lp = list; lp != runi_nil; lp = lp->cdr) {
+        struct runi_object *tmp = runi_eval(ctx, env, lp->car);
+        if (head == NULL) {
+            head = tail = runi_cons(ctx, tmp, runi_nil);
+        } else {
+            tail->cdr = runi_cons(ctx, tmp, runi_nil);
+            tail = tail->cdr;
+        }
+    }
+    if (head == NULL)
+        return runi_nil;
     return head;
 }
 
+static void runi_check_arity(struct runi_context *ctx, struct runi_object *fn, int argc) {
+    if (argc < fn->min_args || (fn->max_args != RUNI_VARARGS && argc > fn->max_args))
+        runi_error(ctx, "Malformed %s", fn->pname);
+}
+
+static struct runi_object *runi_call_primitive(struct runi_context *ctx, struct runi_object *env, struct runi_object *fn, struct runi_object *args) {
+    RUNI_STAT(fn->ncalls++);
+    if (!fn->afn)
+        return fn->fn(ctx, env, args);
+    int argc = runi_list_length(ctx, args);
+    runi_check_arity(ctx, fn, argc);
+    struct runi_object *buf[RUNI_ARGV_STACK];
+    struct runi_object **argv = argc <= RUNI_ARGV_STACK ? buf : runi_make_vector(ctx, argc, runi_nil)->items;
+    for (int i = 0; i < argc; i++, args = args->cdr)
+        argv[i] = runi_eval(ctx, env, args->car);
+    return fn->afn(ctx, env, argc, argv);
+}
+
 bool runi_is_list(struct runi_object *obj) {
-  return obj == runi_nil || obj->type == RUNI_LIST;
+  return obj == runi_nil || runi_type(obj) == RUNI_LIST;
 }
 
-static struct runi_object *runi_apply(struct runi_object *env, struct runi_object *fn, struct runi_object *args) {
-    if (!runi_is_list(args))
-        runi_error("argument must be a list");
-    if (fn->type == RUNI_PRIMITIVE)
-        return fn->fn(env, args);
-    if (fn->type == RUNI_FUNCTION) {
-        struct runi_object *body = fn->body;
-        struct runi_object *args = fn->args;
-        struct runi_object *eargs = runi_eval_list(env, args);
-        struct runi_object *newenv = runi_push_env(fn->env, args, eargs);
-        return runi_progn(newenv, body);
-    }
-    runi_error("not supported");
+static struct runi_object *runi_bind_args(struct runi_context *ctx, struct runi_object *env, struct runi_object *fn, struct runi_object *args) {
+    int nslots = runi_list_length(ctx, fn->args);
+    if (nslots != runi_list_length(ctx, args))
+        runi_error(ctx, "Cannot apply function: number of argument does not match");
+    struct runi_object *newenv = runi_make_frame(ctx, fn->env, fn->args, nslots);
+    for (int i = 0; i < nslots; i++, args = args->cdr)
+        newenv->slots[i] = runi_eval(ctx, env, args->car);
+    return newenv;
 }
 
-struct runi_object *runi_find(struct runi_object *env, struct runi_object *sym) {
+struct runi_object **runi_find(struct runi_context *ctx, struct runi_object *env, struct runi_object *sym) {
+    (void)ctx;
+    RUNI_STAT(ctx->stats.find_calls++);
     for (struct runi_object *p = env; p; p = p->parent) {
+        RUNI_STAT(ctx->stats.find_steps++);
+        if (runi_type(p) == RUNI_FRAME) {
+            size_t i = 0;
+            for (struct runi_object *q = p->params; q != runi_nil; q = q->cdr, i++)
+                if (sym == q->car)
+                    return &p->slots[i];
+        }
         for (struct runi_object *cell = p->vars; cell != runi_nil; cell = cell->cdr) {
             struct runi_object *bind = cell->car;
             if (sym == bind->car)
-                return bind;
+                return &bind->cdr;
         }
+        if (runi_is_global_env(p))
+            return sym->value ? &sym->value : NULL;
     }
     return NULL;
 }
 
-struct runi_object *runi_macroexpand(struct runi_object *env, struct runi_object *obj) {
-    if (obj->type != RUNI_LIST || obj->car->type != RUNI_SYMBOL)
+struct runi_object *runi_eval_globalref(struct runi_context *ctx, struct runi_object *env, struct runi_object *ref) {
+    if (__atomic_load_n(&ref->epoch, __ATOMIC_ACQUIRE) == ctx->global_epoch)
+        return __atomic_load_n(&ref->cache, __ATOMIC_RELAXED);
+    struct runi_object *sym = ref->symbol;
+    struct runi_object **slot = runi_find(ctx, env, sym);
+    if (!slot)
+        runi_error(ctx, "Undefined symbol: %s", sym->name);
+    if (slot == &sym->value && runi_is_callable(*slot) && (!ctx->parent || ctx->global_epoch == ctx->parent->global_epoch)) {
+        __atomic_store_n(&ref->cache, *slot, __ATOMIC_RELAXED);
+        __atomic_store_n(&ref->epoch, ctx->global_epoch, __ATOMIC_RELEASE);
+    }
+    return *slot;
+}
+
+static struct runi_object **runi_local_slot(struct runi_object *env, struct runi_object *ref) {
+    for (int i = 0; i < ref->depth; i++)
+        env = env->parent;
+    assert(runi_type(env) == RUNI_FRAME);
+    return &env->slots[ref->index];
+}
+
+static size_t runi_expansion_index(struct runi_context *ctx, struct runi_object *args) {
+    uintptr_t h = (uintptr_t)args >> 3;
+    return (h * 0x9e3779b97f4a7c15ULL >> 16) & (ctx->expansions_cap - 1);
+}
+
+static void runi_expansion_insert(struct runi_context *ctx, struct runi_expansion *e) {
+    size_t i = runi_expansion_index(ctx, e->args);
+    while (ctx->expansions[i].args && ctx->expansions[i].args != e->args)
+        i = (i + 1) & (ctx->expansions_cap - 1);
+    if (!ctx->expansions[i].args)
+        ctx->expansions_len++;
+    ctx->expansions[i] = *e;
+}
+
+static void runi_expansion_grow(struct runi_context *ctx) {
+    struct runi_expansion *old = ctx->expansions;
+    size_t cap = ctx->expansions_cap;
+    ctx->expansions_cap = cap ? cap * 2 : 64;
+    ctx->expansions = calloc(ctx->expansions_cap, sizeof(*ctx->expansions));
+    if (!ctx->expansions)
+        runi_error(ctx, "Memory exhausted");
+    ctx->expansions_len = 0;
+    for (size_t i = 0; i < cap; i++)
+        if (old[i].args)
+            runi_expansion_insert(ctx, &old[i]);
+    free(old);
+}
+
+static void runi_expansion_clear(struct runi_context *ctx) {
+    if (ctx->expansions_len)
+        memset(ctx->expansions, 0, sizeof(*ctx->expansions) * ctx->expansions_cap);
+    ctx->expansions_len = 0;
+}
+
+struct runi_object *runi_expansion_lookup(struct runi_context *ctx, struct runi_object *macro, struct runi_object *args) {
+    if (!ctx->expansions_cap)
+        return NULL;
+    size_t i = runi_expansion_index(ctx, args);
+    while (ctx->expansions[i].args && ctx->expansions[i].args != args)
+        i = (i + 1) & (ctx->expansions_cap - 1);
+    struct runi_expansion *e = &ctx->expansions[i];
+    return e->args && e->macro == macro ? e->expansion : NULL;
+}
+
+void runi_expansion_add(struct runi_context *ctx, struct runi_object *macro, struct runi_object *args, struct runi_object *expansion) {
+    struct runi_expansion e = { args, macro, expansion };
+    if ((ctx->expansions_len + 1) * 2 > ctx->expansions_cap)
+        runi_expansion_grow(ctx);
+    runi_expansion_insert(ctx, &e);
+}
+
+static struct runi_object *runi_expand_macro(struct runi_context *ctx, struct runi_object *env, struct runi_object *macro, struct runi_object *args) {
+    RUNI_STAT(ctx->stats.macroexpand_calls++);
+    struct runi_object *expansion = runi_expansion_lookup(ctx, macro, args);
+    if (expansion) {
+        RUNI_STAT(ctx->stats.macroexpand_hits++);
+        return expansion;
+    }
+    struct runi_object *newenv = runi_push_frame(ctx, env, macro->args, args);
+    expansion = runi_progn(ctx, newenv, macro->body);
+    runi_expansion_add(ctx, macro, args, expansion);
+    return expansion;
+}
+
+struct runi_object *runi_macroexpand(struct runi_context *ctx, struct runi_object *env, struct runi_object *obj) {
+    if (runi_type(obj) != RUNI_LIST || runi_type(obj->car) != RUNI_SYMBOL)
         return obj;
-    struct runi_object *bind = runi_find(env, obj->car);
-    if (!bind || bind->cdr->type != RUNI_MACRO)
+    struct runi_object **slot = runi_find(ctx, env, obj->car);
+    if (!slot || runi_type((*slot)) != RUNI_MACRO)
         return obj;
-    struct runi_object *args = obj->cdr;
-    struct runi_object *body = bind->cdr->body;
-    struct runi_object *params = bind->cdr->args;
-    struct runi_object *newenv = runi_push_env(env, params, args);
-    return runi_progn(newenv, body);
+    return runi_expand_macro(ctx, env, *slot, obj->cdr);
 }
 
-struct runi_object *runi_eval(struct runi_object *env, struct runi_object *obj) {
-    switch (obj->type) {
-    case RUNI_INTEGER:
+static struct runi_object *runi_if_branch(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+static struct runi_object *runi_guard_branch(struct runi_object *list);
+
+static struct runi_object *runi_jit_tail_frame(struct runi_context *ctx, struct runi_object *fn) {
+    int argc = ctx->jit_tail_argc;
+    struct runi_object *argv[RUNI_JIT_MAX_ARGS];
+    memcpy(argv, ctx->jit_tail_args, sizeof(*argv) * argc);
+    if (runi_list_length(ctx, fn->args) != argc)
+        runi_error(ctx, "Cannot apply function: number of argument does not match");
+    struct runi_object *frame = runi_make_frame(ctx, fn->env, fn->args, argc);
+    memcpy(frame->slots, argv, sizeof(*argv) * argc);
+    return frame;
+}
+
+static struct runi_object *runi_eval_tail(struct runi_context *ctx, struct runi_object *env, struct runi_object *obj) {
+    size_t prof_len = ctx->prof_len;
+    for (;;) {
+        RUNI_STAT(ctx->stats.eval_calls[runi_type(obj)]++);
+        switch (runi_type(obj)) {
+        case RUNI_INTEGER:
+        case RUNI_PRIMITIVE:
+        case RUNI_FUNCTION:
+        case RUNI_NIL:
+        case RUNI_DOT:
+        case RUNI_TRUE:
+        case RUNI_STRING:
+        case RUNI_VECTOR:
+        case RUNI_HASHTABLE:
+            return obj;
+        case RUNI_SYMBOL: {
+            struct runi_object **slot = runi_find(ctx, env, obj);
+            if (!slot)
+                runi_error(ctx, "Undefined symbol: %s", obj->name);
+            return *slot;
+        }
+        case RUNI_LOCALREF:
+            return *runi_local_slot(env, obj);
+        case RUNI_GLOBALREF:
+            return runi_eval_globalref(ctx, env, obj);
+        case RUNI_LIST: {
+            struct runi_object *fn = runi_eval(ctx, env, obj->car);
+            struct runi_object *args = obj->cdr;
+            if (!runi_is_list(args))
+                runi_error(ctx, "argument must be a list");
+            if (runi_type(fn) == RUNI_MACRO) {
+                obj = runi_expand_macro(ctx, env, fn, args);
+                continue;
+            }
+            if (runi_type(fn) == RUNI_PRIMITIVE) {
+                if (fn == runi_guard_marker) {
+                    obj = runi_guard_branch(args);
+                    continue;
+                }
+                if (fn->fn != runi_prim_if)
+                    return runi_call_primitive(ctx, env, fn, args);
+                RUNI_STAT(fn->ncalls++);
+                obj = runi_if_branch(ctx, env, args);
+                continue;
+            }
+            if (runi_type(fn) == RUNI_FUNCTION) {
+                env = runi_bind_args(ctx, env, fn, args);
+                ctx->prof_len = prof_len;
+                if (ctx->jit_enabled && runi_jit_ready(ctx, fn)) {
+                    struct runi_object *r = runi_jit_enter(ctx, fn, env->slots);
+                    if (r)
+                        return r;
+                    fn = ctx->jit_tail_fn;
+                    env = runi_jit_tail_frame(ctx, fn);
+                }
+                if (fn->memo)
+                    return runi_memo_call(ctx, fn, env);
+                runi_prof_push(ctx, fn);
+                if (ctx->vm_enabled && runi_vm_compile(ctx, fn))
+                    return runi_vm_execute(ctx, fn, env);
+                obj = runi_progn_tail(ctx, env, runi_function_body(ctx, fn));
+                continue;
+            }
+            runi_error(ctx, "The head of a list must be a function");
+        }
+        default:
+            runi_error(ctx, "Bug: eval: Unknown tag type: %d", runi_type(obj));
+        }
+    }
+}
+
+struct runi_object *runi_invoke(struct runi_context *ctx, struct runi_object *fn, struct runi_object *frame) {
+    size_t prof_len = ctx->prof_len;
+    runi_prof_push(ctx, fn);
+    struct runi_object *r;
+    if (ctx->vm_enabled && runi_vm_compile(ctx, fn))
+        r = runi_vm_execute(ctx, fn, frame);
+    else
+        r = runi_progn(ctx, frame, runi_function_body(ctx, fn));
+    ctx->prof_len = prof_len;
+    return r;
+}
+
+struct runi_object *runi_apply(struct runi_context *ctx, struct runi_object *env, struct runi_object *fn, struct runi_object *args) {
+    if (!runi_is_list(args))
+        runi_error(ctx, "argument must be a list");
+    switch (runi_type(fn)) {
+    case RUNI_MACRO:
+        return runi_eval(ctx, env, runi_expand_macro(ctx, env, fn, args));
     case RUNI_PRIMITIVE:
-    case RUNI_FUNCTION:
+        return runi_call_primitive(ctx, env, fn, args);
+    case RUNI_FUNCTION: {
+        env = runi_bind_args(ctx, env, fn, args);
+        if (fn->memo)
+            return runi_memo_call(ctx, fn, env);
+        if (ctx->jit_enabled && runi_jit_ready(ctx, fn))
+            return runi_jit_call(ctx, fn, env->slots);
+        return runi_invoke(ctx, fn, env);
+    }
+    default:
+        runi_error(ctx, "The head of a list must be a function");
+    }
+}
+
+static struct runi_object runi_quote_primitive = {
+    .type = RUNI_PRIMITIVE, .flags = RUNI_GC_STATIC, .fn = runi_prim_quote
+};
+
+struct runi_object *runi_funcall(struct runi_context *ctx, struct runi_object *env, struct runi_object *fn, int argc, struct runi_object **argv) {
+    switch (runi_type(fn)) {
+    case RUNI_PRIMITIVE: {
+        if (fn->afn) {
+            runi_check_arity(ctx, fn, argc);
+            RUNI_STAT(fn->ncalls++);
+            return fn->afn(ctx, env, argc, argv);
+        }
+        struct runi_object *args = runi_nil;
+        for (int i = argc - 1; i >= 0; i--)
+            args = runi_cons(ctx, runi_cons(ctx, &runi_quote_primitive, runi_cons(ctx, argv[i], runi_nil)), args);
+        RUNI_STAT(fn->ncalls++);
+        return fn->fn(ctx, env, args);
+    }
+    case RUNI_FUNCTION: {
+        if (runi_list_length(ctx, fn->args) != argc)
+            runi_error(ctx, "Cannot apply function: number of argument does not match");
+        if (ctx->jit_enabled && runi_jit_ready(ctx, fn))
+            return runi_jit_call(ctx, fn, argv);
+        struct runi_object *frame = runi_make_frame(ctx, fn->env, fn->args, argc);
+        for (int i = 0; i < argc; i++)
+            frame->slots[i] = argv[i];
+        if (fn->memo)
+            return runi_memo_call(ctx, fn, frame);
+        return runi_invoke(ctx, fn, frame);
+    }
+    default:
+        runi_error(ctx, "The head of a list must be a function");
+    }
+}
+
+struct runi_object *runi_eval(struct runi_context *ctx, struct runi_object *env, struct runi_object *obj) {
+    if (ctx->eval_depth >= ctx->max_eval_depth)
+        runi_error(ctx, "Recursion too deep: evaluation depth exceeds %d", ctx->max_eval_depth);
+    ctx->eval_depth++;
+    RUNI_STAT(if (ctx->eval_depth > ctx->stats.max_eval_depth) ctx->stats.max_eval_depth = ctx->eval_depth);
+    size_t prof_len = ctx->prof_len;
+    struct runi_object *r = runi_eval_tail(ctx, env, obj);
+    ctx->prof_len = prof_len;
+    ctx->eval_depth--;
+    return r;
+}
+struct runi_object *runi_prim_quote(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    (void)env;
+    if (runi_list_length(ctx, list) != 1)
+        runi_error(ctx, "Malformed quote");
+    return list->car;
+}
+
+struct runi_object *runi_prim_list(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    struct runi_object *r = runi_nil;
+    for (int i = argc - 1; i >= 0; i--)
+        r = runi_cons(ctx, argv[i], r);
+    return r;
+}
+
+struct runi_object *runi_prim_cons(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    return runi_cons(ctx, argv[0], argv[1]);
+}
+
+struct runi_object *runi_prim_car(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    struct runi_object *obj = argv[0];
+    if (obj == runi_nil)
+        return runi_nil;
+    if (runi_type(obj) != RUNI_LIST)
+        runi_error(ctx, "car takes a list");
+    return obj->car;
+}
+
+struct runi_object *runi_prim_cdr(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    struct runi_object *obj = argv[0];
+    if (obj == runi_nil)
+        return runi_nil;
+    if (runi_type(obj) != RUNI_LIST)
+        runi_error(ctx, "cdr takes a list");
+    return obj->cdr;
+}
+
+struct runi_object *runi_prim_setq(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    if (runi_list_length(ctx, list) != 2)
+        runi_error(ctx, "Malformed setq");
+    struct runi_object **slot;
+    if (runi_type(list->car) == RUNI_LOCALREF) {
+        slot = runi_local_slot(env, list->car);
+    } else {
+        if (runi_type(list->car) != RUNI_SYMBOL)
+            runi_error(ctx, "Malformed setq");
+        slot = runi_find(ctx, env, list->car);
+        if (!slot)
+            runi_error(ctx, "Unbound variable %s", list->car->name);
+    }
+    struct runi_object *value = runi_eval(ctx, env, list->cdr->car);
+    runi_set_slot(ctx, slot, value);
+    return value;
+}
+
+static int64_t runi_check_integer(struct runi_context *ctx, struct runi_object *obj, char *msg) {
+    if (!runi_is_fixnum(obj))
+        runi_error(ctx, "%s", msg);
+    return runi_fixnum_value(obj);
+}
+
+struct runi_object *runi_prim_plus(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    int64_t sum = 0;
+    for (int i = 0; i < argc; i++) {
+        sum += runi_check_integer(ctx, argv[i], "+ takes only numbers");
+        if (sum < RUNI_FIXNUM_MIN || sum > RUNI_FIXNUM_MAX)
+            runi_error(ctx, "Integer overflow");
+    }
+    return runi_fixnum(sum);
+}
+
+enum {
+    RUNI_FORM_CALL,
+    RUNI_FORM_OPAQUE,
+    RUNI_FORM_LAMBDA,
+    RUNI_FORM_SETQ,
+    RUNI_FORM_DEFINE,
+    RUNI_FORM_DEFUN,
+};
+
+struct runi_scope {
+    struct runi_object *params;
+    struct runi_object *defined;
+    struct runi_scope *parent;
+    bool dynamic;
+};
+
+static bool runi_memq(struct runi_object *obj, struct runi_object *list) {
+    for (; list != runi_nil; list = list->cdr)
+        if (list->car == obj)
+            return true;
+    return false;
+}
+
+static bool runi_is_param_list(struct runi_object *params) {
+    for (; params != runi_nil; params = params->cdr)
+        if (runi_type(params) != RUNI_LIST || runi_type(params->car) != RUNI_SYMBOL)
+            return false;
+    return true;
+}
+
+static bool runi_scope_binds(struct runi_scope *scope, struct runi_object *sym) {
+    for (; scope; scope = scope->parent)
+        if (runi_memq(sym, scope->params) || runi_memq(sym, scope->defined))
+            return true;
+    return false;
+}
+
+static struct runi_object *runi_prim_lambda_analyzed(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+static struct runi_object runi_lambda_analyzed = {
+    .type = RUNI_PRIMITIVE, .flags = RUNI_GC_STATIC, .fn = runi_prim_lambda_analyzed
+};
+struct runi_object *const runi_lambda_marker = &runi_lambda_analyzed;
+
+static struct runi_object *runi_prim_guard(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+static struct runi_object runi_guard = {
+    .type = RUNI_PRIMITIVE, .flags = RUNI_GC_STATIC, .fn = runi_prim_guard
+};
+struct runi_object *const runi_guard_marker = &runi_guard;
+
+static bool runi_is_call_primitive(struct runi_object *fn) {
+    return fn->afn || fn->fn == runi_prim_if;
+}
+
+static int runi_classify_form(struct runi_context *ctx, struct runi_object *env, struct runi_scope *scope, struct runi_object *form) {
+    struct runi_object *head = form->car;
+    if (runi_type(head) != RUNI_SYMBOL || runi_scope_binds(scope, head))
+        return RUNI_FORM_CALL;
+    struct runi_object **slot = runi_find(ctx, env, head);
+    if (!slot)
+        return RUNI_FORM_CALL;
+    struct runi_object *fn = *slot;
+    if (runi_type(fn) == RUNI_MACRO)
+        return RUNI_FORM_OPAQUE;
+    if (runi_type(fn) != RUNI_PRIMITIVE)
+        return RUNI_FORM_CALL;
+    if (fn->fn == runi_prim_lambda)
+        return RUNI_FORM_LAMBDA;
+    if (fn->fn == runi_prim_setq)
+        return RUNI_FORM_SETQ;
+    if (fn->fn == runi_prim_define)
+        return RUNI_FORM_DEFINE;
+    if (fn->fn == runi_prim_defun || fn->fn == runi_prim_defmacro)
+        return RUNI_FORM_DEFUN;
+    if (runi_is_call_primitive(fn))
+        return RUNI_FORM_CALL;
+    return RUNI_FORM_OPAQUE;
+}
+
+static struct runi_object *runi_collect_defined(struct runi_context *ctx, struct runi_object *env, struct runi_scope *scope, struct runi_object *form, struct runi_object *defined) {
+    if (runi_type(form) != RUNI_LIST)
+        return defined;
+    int kind = runi_classify_form(ctx, env, scope, form);
+    if (kind == RUNI_FORM_DEFINE || kind == RUNI_FORM_DEFUN)
+        if (runi_type(form->cdr) == RUNI_LIST && runi_type(form->cdr->car) == RUNI_SYMBOL)
+            defined = runi_cons(ctx, form->cdr->car, defined);
+    if (kind == RUNI_FORM_CALL || kind == RUNI_FORM_SETQ || kind == RUNI_FORM_DEFINE)
+        for (struct runi_object *p = form; runi_type(p) == RUNI_LIST; p = p->cdr)
+            defined = runi_collect_defined(ctx, env, scope, p->car, defined);
+    return defined;
+}
+
+static struct runi_object *runi_analyze_body(struct runi_context *ctx, struct runi_object *env, struct runi_scope *scope, struct runi_object *body);
+
+static struct runi_object *runi_analyze(struct runi_context *ctx, struct runi_object *env, struct runi_scope *scope, struct runi_object *form) {
+    if (runi_type(form) == RUNI_SYMBOL) {
+        int depth = 0;
+        for (struct runi_scope *s = scope; s; s = s->parent, depth++) {
+            int index = 0;
+            for (struct runi_object *p = s->params; p != runi_nil; p = p->cdr, index++)
+                if (p->car == form)
+                    return runi_make_localref(ctx, form, depth, index);
+            if (runi_memq(form, s->defined))
+                return form;
+        }
+        return form;
+    }
+    if (runi_type(form) != RUNI_LIST)
+        return form;
+
+    switch (runi_classify_form(ctx, env, scope, form)) {
+    case RUNI_FORM_CALL: {
+        struct runi_object *call = runi_analyze_body(ctx, env, scope, form);
+        if (runi_type(call->car) == RUNI_SYMBOL && !scope->dynamic)
+            call->car = runi_make_globalref(ctx, call->car);
+        return call;
+    }
+    case RUNI_FORM_LAMBDA: {
+        struct runi_object *rest = form->cdr;
+        if (runi_type(rest) != RUNI_LIST || !runi_is_param_list(rest->car) || runi_type(rest->cdr) != RUNI_LIST)
+            return form;
+        struct runi_scope inner = { rest->car, runi_nil, scope, scope->dynamic };
+        for (struct runi_object *p = rest->cdr; runi_type(p) == RUNI_LIST; p = p->cdr)
+            inner.defined = runi_collect_defined(ctx, env, &inner, p->car, inner.defined);
+        struct runi_object *body = runi_analyze_body(ctx, env, &inner, rest->cdr);
+        return runi_cons(ctx, &runi_lambda_analyzed, runi_cons(ctx, rest->car, body));
+    }
+    case RUNI_FORM_SETQ:
+    case RUNI_FORM_DEFINE: {
+        if (runi_type(form->cdr) != RUNI_LIST || runi_type(form->cdr->cdr) != RUNI_LIST)
+            return form;
+        struct runi_object *target = form->cdr->car;
+        if (runi_classify_form(ctx, env, scope, form) == RUNI_FORM_SETQ)
+            target = runi_analyze(ctx, env, scope, target);
+        struct runi_object *rest = runi_analyze_body(ctx, env, scope, form->cdr->cdr);
+        return runi_cons(ctx, form->car, runi_cons(ctx, target, rest));
+    }
+    default:
+        return form;
+    }
+}
+
+static struct runi_object *runi_analyze_body(struct runi_context *ctx, struct runi_object *env, struct runi_scope *scope, struct runi_object *body) {
+    if (runi_type(body) != RUNI_LIST)
+        return body;
+    struct runi_object *head = runi_cons(ctx, runi_analyze(ctx, env, scope, body->car), runi_nil);
+    struct runi_object *tail = head;
+    for (body = body->cdr; runi_type(body) == RUNI_LIST; body = body->cdr) {
+        tail->cdr = runi_cons(ctx, runi_analyze(ctx, env, scope, body->car), runi_nil);
+        tail = tail->cdr;
+    }
+    tail->cdr = body;
+    return head;
+}
+
+struct runi_optimizer {
+    struct runi_object *env;
+    struct runi_scope *scope;
+    struct runi_object *deps;
+    struct runi_object *site;
+    int depth;
+};
+
+static struct runi_object *runi_optimize(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *form);
+
+static bool runi_is_foldable_primitive(struct runi_object *fn) {
+    return fn->afn == runi_prim_plus || fn->afn == runi_prim_minus || fn->afn == runi_prim_num_eq || fn->afn == runi_prim_lt
+        || fn->afn == runi_prim_car || fn->afn == runi_prim_cdr || fn->afn == runi_prim_string_length
+        || fn->afn == runi_prim_substring || fn->afn == runi_prim_string_append || fn->afn == runi_prim_string_eq
+        || fn->afn == runi_prim_string_search;
+}
+
+static struct runi_object *runi_opt_resolve(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *head, struct runi_object **sym) {
+    if (runi_type(head) == RUNI_GLOBALREF)
+        head = head->symbol;
+    if (runi_type(head) != RUNI_SYMBOL || runi_scope_binds(o->scope, head))
+        return NULL;
+    struct runi_object **slot = runi_find(ctx, o->env, head);
+    if (!slot || slot != &head->value)
+        return NULL;
+    *sym = head;
+    return *slot;
+}
+
+static struct runi_object *runi_opt_adjoin(struct runi_context *ctx, struct runi_object *deps, struct runi_object *sym, struct runi_object *value) {
+    for (struct runi_object *p = deps; p != runi_nil; p = p->cdr)
+        if (p->car->car == sym)
+            return deps;
+    return runi_acons(ctx, sym, value, deps);
+}
+
+static void runi_opt_depend(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *sym, struct runi_object *value) {
+    o->site = runi_opt_adjoin(ctx, o->site, sym, value);
+}
+
+static bool runi_opt_constant(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *form, struct runi_object **value) {
+    switch (runi_type(form)) {
+    case RUNI_INTEGER:
+    case RUNI_STRING:
     case RUNI_NIL:
-    case RUNI_DOT:
     case RUNI_TRUE:
+        *value = form;
+        return true;
+    case RUNI_GLOBALREF: {
+        struct runi_object *sym;
+        if (runi_opt_resolve(ctx, o, form, &sym) != runi_true)
+            return false;
+        runi_opt_depend(ctx, o, sym, runi_true);
+        *value = runi_true;
+        return true;
+    }
+    case RUNI_LIST: {
+        if (form->car == runi_guard_marker) {
+            if (!runi_opt_constant(ctx, o, form->cdr->cdr->car, value))
+                return false;
+            for (struct runi_object *p = form->cdr->car; p != runi_nil; p = p->cdr)
+                runi_opt_depend(ctx, o, p->car->car, p->car->cdr);
+            return true;
+        }
+        struct runi_object *sym;
+        struct runi_object *fn = runi_opt_resolve(ctx, o, form->car, &sym);
+        if (!fn || runi_type(fn) != RUNI_PRIMITIVE || fn->fn != runi_prim_quote
+            || runi_type(form->cdr) != RUNI_LIST || form->cdr->cdr != runi_nil)
+            return false;
+        *value = form->cdr->car;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static bool runi_opt_pure(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *form) {
+    struct runi_object *value, *sym;
+    if (runi_type(form) == RUNI_LOCALREF || runi_type(form) == RUNI_GLOBALREF || runi_opt_constant(ctx, o, form, &value))
+        return true;
+    if (runi_type(form) != RUNI_LIST)
+        return false;
+    struct runi_object *fn = runi_opt_resolve(ctx, o, form->car, &sym);
+    if (!fn || runi_type(fn) != RUNI_PRIMITIVE || !runi_is_foldable_primitive(fn))
+        return false;
+    struct runi_object *p = form->cdr;
+    for (; runi_type(p) == RUNI_LIST; p = p->cdr)
+        if (!runi_opt_pure(ctx, o, p->car))
+            return false;
+    return p == runi_nil;
+}
+
+static struct runi_object *runi_opt_fold(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *form, struct runi_object *sym, struct runi_object *fn) {
+    struct runi_object *argv[RUNI_ARGV_STACK], *value;
+    int argc = 0;
+    for (struct runi_object *p = form->cdr; p != runi_nil; p = p->cdr)
+        if (argc == RUNI_ARGV_STACK || !runi_opt_constant(ctx, o, p->car, &argv[argc++]))
+            return form;
+    struct runi_object *quote = runi_intern(ctx, "quote");
+    if (runi_scope_binds(o->scope, quote))
+        return form;
+    struct runi_handler handler;
+    if (setjmp(handler.buf))
+        return form;
+    runi_push_handler(ctx, &handler);
+    runi_check_arity(ctx, fn, argc);
+    value = fn->afn(ctx, o->env, argc, argv);
+    runi_pop_handler(ctx, &handler);
+    runi_opt_depend(ctx, o, sym, fn);
+    switch (runi_type(value)) {
+    case RUNI_INTEGER:
     case RUNI_STRING:
-        return obj;
-    case RUNI_SYMBOL: {
-        struct runi_object *bind = runi_find(env, obj);
-        if (!bind)
-            runi_error("Undefined symbol: %s", obj->name);
-        return bind->cdr;
+    case RUNI_NIL:
+    case RUNI_TRUE:
+        return value;
+    default:
+        return runi_cons(ctx, quote, runi_cons(ctx, value, runi_nil));
     }
+}
+
+static struct runi_object *runi_opt_if(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *form, struct runi_object *sym, struct runi_object *fn) {
+    struct runi_object *args = form->cdr, *value;
+    if (runi_type(args) != RUNI_LIST || runi_type(args->cdr) != RUNI_LIST || !runi_opt_constant(ctx, o, args->car, &value))
+        return form;
+    struct runi_object *rest = args->cdr->cdr;
+    if (value == runi_nil && rest != runi_nil && rest->cdr != runi_nil)
+        return form;
+    runi_opt_depend(ctx, o, sym, fn);
+    if (value != runi_nil)
+        return args->cdr->car;
+    return rest == runi_nil ? runi_nil : rest->car;
+}
+
+static bool runi_opt_inlinable(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *form, struct runi_object *sym, struct runi_object *fn, int *uses, int nparams, int *nodes) {
+    struct runi_object *value;
+    if (++*nodes > RUNI_OPT_INLINE_NODES)
+        return false;
+    switch (runi_type(form)) {
+    case RUNI_INTEGER:
+    case RUNI_STRING:
+    case RUNI_NIL:
+    case RUNI_TRUE:
+        return true;
+    case RUNI_LOCALREF:
+        if (form->depth != 0 || form->index >= nparams)
+            return false;
+        uses[form->index]++;
+        return true;
+    case RUNI_GLOBALREF:
+        return form->symbol != sym && form->symbol != fn->fname && !runi_scope_binds(o->scope, form->symbol);
     case RUNI_LIST: {
-        struct runi_object *expanded = runi_macroexpand(env, obj);
-        if (expanded != obj)
-            return runi_eval(env, expanded);
-        struct runi_object *fn = runi_eval(env, obj->car);
-        struct runi_object *args = obj->cdr;
-        if (fn->type != RUNI_PRIMITIVE && fn->type != RUNI_FUNCTION)
-            runi_error("The head of a list must be a function");
-        return runi_apply(env, fn, args);
+        if (form->car == runi_guard_marker)
+            return runi_opt_inlinable(ctx, o, form->cdr->cdr->car, sym, fn, uses, nparams, nodes)
+                && runi_opt_inlinable(ctx, o, form->cdr->cdr->cdr->car, sym, fn, uses, nparams, nodes);
+        if (runi_opt_constant(ctx, o, form, &value))
+            return true;
+        struct runi_object *head = form->car;
+        if (runi_type(head) != RUNI_GLOBALREF || !runi_opt_inlinable(ctx, o, head, sym, fn, uses, nparams, nodes))
+            return false;
+        struct runi_object *v = head->symbol->value;
+        if (v && (runi_type(v) == RUNI_MACRO || (runi_type(v) == RUNI_PRIMITIVE && !runi_is_call_primitive(v))))
+            return false;
+        struct runi_object *p = form->cdr;
+        for (; runi_type(p) == RUNI_LIST; p = p->cdr)
+            if (!runi_opt_inlinable(ctx, o, p->car, sym, fn, uses, nparams, nodes))
+                return false;
+        return p == runi_nil;
     }
     default:
-        runi_error("Bug: eval: Unknown tag type: %d", obj->type);
+        return false;
     }
 }
-struct runi_object *runi_prim_quote(struct runi_object *env, struct runi_object *list) {
-    if (runi_list_length(list) != 1)
-        runi_error("Malformed quote");
-    return list->car;
+
+static struct runi_object *runi_opt_subst(struct runi_context *ctx, struct runi_object *form, struct runi_object **args) {
+    if (runi_type(form) == RUNI_LOCALREF)
+        return args[form->index];
+    if (runi_type(form) != RUNI_LIST)
+        return form;
+    if (form->car == runi_guard_marker)
+        return runi_cons(ctx, form->car, runi_cons(ctx, form->cdr->car, runi_opt_subst(ctx, form->cdr->cdr, args)));
+    return runi_cons(ctx, runi_opt_subst(ctx, form->car, args), runi_opt_subst(ctx, form->cdr, args));
+}
+
+static struct runi_object *runi_opt_inline(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *form, struct runi_object *sym, struct runi_object *fn) {
+    struct runi_object *args[RUNI_OPT_INLINE_PARAMS];
+    int uses[RUNI_OPT_INLINE_PARAMS] = { 0 };
+    int nparams = 0, nodes = 0;
+    if (o->depth >= RUNI_OPT_MAX_DEPTH || fn->memo || !runi_is_global_env(fn->env))
+        return form;
+    struct runi_object *body = runi_function_body(ctx, fn);
+    if (body != fn->body || runi_type(body) != RUNI_LIST || body->cdr != runi_nil)
+        return form;
+    struct runi_object *p = fn->args, *a = form->cdr;
+    for (; p != runi_nil; p = p->cdr, a = a->cdr, nparams++) {
+        if (nparams == RUNI_OPT_INLINE_PARAMS || runi_type(a) != RUNI_LIST)
+            return form;
+        args[nparams] = a->car;
+    }
+    if (a != runi_nil || !runi_opt_inlinable(ctx, o, body->car, sym, fn, uses, nparams, &nodes))
+        return form;
+    for (int i = 0; i < nparams; i++) {
+        struct runi_object *value;
+        bool trivial = runi_type(args[i]) == RUNI_LOCALREF || runi_type(args[i]) == RUNI_GLOBALREF || runi_opt_constant(ctx, o, args[i], &value);
+        if (!trivial && (uses[i] != 1 || !runi_opt_pure(ctx, o, args[i])))
+            return form;
+    }
+    runi_opt_depend(ctx, o, sym, fn);
+    for (struct runi_object *d = fn->deps; d != runi_nil; d = d->cdr)
+        runi_opt_depend(ctx, o, d->car->car, d->car->cdr);
+    o->depth++;
+    struct runi_object *r = runi_optimize(ctx, o, runi_opt_subst(ctx, body->car, args));
+    o->depth--;
+    return r;
 }
 
-struct runi_object *runi_prim_list(struct runi_object *env, struct runi_object *list) {
-    return runi_eval_list(env, list);
+static struct runi_object *runi_opt_expand(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *form, struct runi_object *sym, struct runi_object *macro) {
+    if (o->depth >= RUNI_OPT_MAX_DEPTH || !runi_is_list(form->cdr))
+        return form;
+    struct runi_handler handler;
+    if (setjmp(handler.buf))
+        return form;
+    runi_push_handler(ctx, &handler);
+    struct runi_object *expansion = runi_expand_macro(ctx, o->env, macro, form->cdr);
+    runi_pop_handler(ctx, &handler);
+    runi_opt_depend(ctx, o, sym, macro);
+    o->depth++;
+    struct runi_object *r = runi_optimize(ctx, o, runi_analyze(ctx, o->env, o->scope, expansion));
+    o->depth--;
+    return r;
 }
 
-struct runi_object *runi_prim_setq(struct runi_object *env, struct runi_object *list) {
-    if (runi_list_length(list) != 2 || list->car->type != RUNI_SYMBOL)
-        runi_error("Malformed setq");
-    struct runi_object *bind = runi_find(env, list->car);
-    if (!bind)
-        runi_error("Unbound variable %s", list->car->name);
-    struct runi_object *value = runi_eval(env, list->cdr->car);
-    bind->cdr = value;
-    return value;
+static struct runi_object *runi_opt_list(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *list) {
+    struct runi_object *head = runi_nil, *tail = NULL;
+    for (; runi_type(list) == RUNI_LIST; list = list->cdr) {
+        struct runi_object *cell = runi_cons(ctx, runi_optimize(ctx, o, list->car), runi_nil);
+        if (tail)
+            tail->cdr = cell;
+        else
+            head = cell;
+        tail = cell;
+    }
+    return list == runi_nil ? head : NULL;
+}
+
+static struct runi_object *runi_opt_form(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object **form);
+
+static struct runi_object *runi_optimize(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object *form) {
+    if (runi_type(form) != RUNI_LIST || form->car == runi_lambda_marker || form->car == runi_guard_marker)
+        return form;
+    struct runi_object *site = o->site;
+    o->site = runi_nil;
+    struct runi_object *r = runi_opt_form(ctx, o, &form);
+    if (r != form && o->site != runi_nil) {
+        for (struct runi_object *p = o->site; p != runi_nil; p = p->cdr)
+            o->deps = runi_opt_adjoin(ctx, o->deps, p->car->car, p->car->cdr);
+        r = runi_cons(ctx, runi_guard_marker, runi_cons(ctx, o->site, runi_cons(ctx, r, runi_cons(ctx, form, runi_nil))));
+    }
+    o->site = site;
+    return r;
 }
 
-struct runi_object *runi_prim_plus(struct runi_object *env, struct runi_object *list) {
-    int sum = 0;
-    for (struct runi_object *args = runi_eval_list(env, list); args != runi_nil; args = args->cdr) {
-        if (args->car->type != RUNI_INTEGER)
-            runi_error("+ takes only numbers");
-        sum += args->car->integer;
+static struct runi_object *runi_opt_form(struct runi_context *ctx, struct runi_optimizer *o, struct runi_object **formp) {
+    struct runi_object *form = *formp;
+    struct runi_object *sym = NULL;
+    struct runi_object *fn = runi_opt_resolve(ctx, o, form->car, &sym);
+    if (runi_type(form->car) == RUNI_SYMBOL && fn) {
+        if (runi_type(fn) == RUNI_MACRO)
+            return runi_opt_expand(ctx, o, form, sym, fn);
+        if (runi_type(fn) == RUNI_PRIMITIVE && (fn->fn == runi_prim_setq || fn->fn == runi_prim_define)
+            && runi_list_length(ctx, form) == 3)
+            return runi_cons(ctx, form->car, runi_cons(ctx, form->cdr->car, runi_opt_list(ctx, o, form->cdr->cdr)));
+        if (runi_type(fn) == RUNI_PRIMITIVE && !runi_is_call_primitive(fn))
+            return form;
     }
-    return runi_make_integer(sum);
+    struct runi_object *args = runi_opt_list(ctx, o, form->cdr);
+    if (!args)
+        return form;
+    form = *formp = runi_cons(ctx, form->car, args);
+    if (fn && runi_type(fn) == RUNI_PRIMITIVE && fn->fn == runi_prim_if)
+        return runi_opt_if(ctx, o, form, sym, fn);
+    if (fn && runi_type(fn) == RUNI_PRIMITIVE && runi_is_foldable_primitive(fn))
+        return runi_opt_fold(ctx, o, form, sym, fn);
+    if (fn && runi_type(fn) == RUNI_FUNCTION)
+        return runi_opt_inline(ctx, o, form, sym, fn);
+    return form;
 }
 
-static struct runi_object *runi_handle_function(struct runi_object *env, struct runi_object *list, int type) {
-    if (list->type != RUNI_LIST || !runi_is_list(list->car) || list->cdr->type != RUNI_LIST)
-        runi_error("Malformed lambda");
+static void runi_optimize_function(struct runi_context *ctx, struct runi_object *fn) {
+    struct runi_object *source = fn->source ? fn->source : fn->body;
+    struct runi_scope scope = { fn->args, runi_nil, NULL, false };
+    for (struct runi_object *p = source; runi_type(p) == RUNI_LIST; p = p->cdr)
+        scope.defined = runi_collect_defined(ctx, fn->env, &scope, p->car, scope.defined);
+    fn->body = source;
+    fn->source = NULL;
+    fn->deps = runi_nil;
+    fn->code = NULL;
+    if (fn->native)
+        runi_jit_retire(ctx, fn->native);
+    fn->native = NULL;
+    fn->calls = 0;
+    fn->depoch = ctx->global_epoch;
+    struct runi_optimizer o = { fn->env, &scope, runi_nil, runi_nil, 0 };
+    struct runi_object *body = runi_opt_list(ctx, &o, source);
+    if (!body || o.deps == runi_nil)
+        return;
+    fn->body = body;
+    fn->source = source;
+    fn->deps = o.deps;
+}
+
+struct runi_object *runi_function_body(struct runi_context *ctx, struct runi_object *fn) {
+    if (!fn->source || __atomic_load_n(&fn->depoch, __ATOMIC_RELAXED) == ctx->global_epoch)
+        return fn->body;
+    bool valid = true;
+    for (struct runi_object *p = fn->deps; p != runi_nil && valid; p = p->cdr)
+        valid = p->car->car->value == p->car->cdr;
+    if (ctx->parent) {
+        if (valid && ctx->global_epoch == ctx->parent->global_epoch)
+            __atomic_store_n(&fn->depoch, ctx->global_epoch, __ATOMIC_RELAXED);
+        return valid ? fn->body : fn->source;
+    }
+    if (valid)
+        fn->depoch = ctx->global_epoch;
+    else
+        runi_optimize_function(ctx, fn);
+    return fn->body;
+}
+
+static void runi_check_params(struct runi_context *ctx, struct runi_object *list) {
+    if (runi_type(list) != RUNI_LIST || !runi_is_list(list->car) || runi_type(list->cdr) != RUNI_LIST)
+        runi_error(ctx, "Malformed lambda");
     for (struct runi_object *p = list->car; p != runi_nil; p = p->cdr) {
-        if (p->car->type != RUNI_SYMBOL)
-            runi_error("Parameter must be a symbol");
+        if (runi_type(p->car) != RUNI_SYMBOL)
+            runi_error(ctx, "Parameter must be a symbol");
         if (!runi_is_list(p->cdr))
-            runi_error("Parameter list is not a flat list");
+            runi_error(ctx, "Parameter list is not a flat list");
+    }
+}
+
+struct runi_object *runi_prim_minus(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    int64_t r = runi_check_integer(ctx, argv[0], "- takes only numbers");
+    if (argc == 1)
+        return runi_make_integer(ctx, -r);
+    for (int i = 1; i < argc; i++) {
+        r -= runi_check_integer(ctx, argv[i], "- takes only numbers");
+        if (r < RUNI_FIXNUM_MIN || r > RUNI_FIXNUM_MAX)
+            runi_error(ctx, "Integer overflow");
     }
-    struct runi_object *car = list->car;
-    struct runi_object *cdr = list->cdr;
-    return runi_make_function(type, car, cdr, env);
+    return runi_fixnum(r);
+}
+
+static struct runi_object *runi_handle_function(struct runi_context *ctx, struct runi_object *env, struct runi_object *list, int type) {
+    runi_check_params(ctx, list);
+    struct runi_scope scope = { list->car, runi_nil, NULL, type == RUNI_MACRO };
+    for (struct runi_object *p = list->cdr; p != runi_nil; p = p->cdr)
+        scope.defined = runi_collect_defined(ctx, env, &scope, p->car, scope.defined);
+    struct runi_object *body = runi_analyze_body(ctx, env, &scope, list->cdr);
+    struct runi_object *fn = runi_make_function(ctx, type, env, list->car, body);
+    if (type == RUNI_FUNCTION && runi_is_global_env(env))
+        runi_optimize_function(ctx, fn);
+    return fn;
+}
+
+static struct runi_object *runi_prim_lambda_analyzed(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    runi_check_params(ctx, list);
+    return runi_make_function(ctx, RUNI_FUNCTION, env, list->car, list->cdr);
 }
 
-struct runi_object *runi_prim_lambda(struct runi_object *env, struct runi_object *list) {
-    return runi_handle_function(env, list, RUNI_FUNCTION);
+static struct runi_object *runi_guard_branch(struct runi_object *list) {
+    for (struct runi_object *p = list->car; p != runi_nil; p = p->cdr)
+        if (p->car->car->value != p->car->cdr)
+            return list->cdr->cdr->car;
+    return list->cdr->car;
 }
 
-struct runi_object *runi_handle_defun(struct runi_object *env, struct runi_object *list, int type) {
-    if (list->car->type != RUNI_SYMBOL || list->cdr->type != RUNI_LIST)
-        runi_error("Malformed defun");
+static struct runi_object *runi_prim_guard(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    return runi_eval(ctx, env, runi_guard_branch(list));
+}
+
+struct runi_object *runi_prim_lambda(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    return runi_handle_function(ctx, env, list, RUNI_FUNCTION);
+}
+
+struct runi_object *runi_handle_defun(struct runi_context *ctx, struct runi_object *env, struct runi_object *list, int type) {
+    if (runi_type(list->car) != RUNI_SYMBOL || runi_type(list->cdr) != RUNI_LIST)
+        runi_error(ctx, "Malformed defun");
     struct runi_object *sym = list->car;
     struct runi_object *rest = list->cdr;
-    struct runi_object *fn = runi_handle_function(env, rest, type);
-    runi_add_variable(env, sym, fn);
+    struct runi_object *fn = runi_handle_function(ctx, env, rest, type);
+    fn->fname = sym;
+    runi_add_variable(ctx, env, sym, fn);
     return fn;
 }
 
-struct runi_object *runi_prim_defun(struct runi_object *env, struct runi_object *list) {
-    return runi_handle_defun(env, list, RUNI_FUNCTION);
+struct runi_object *runi_prim_defun(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    return runi_handle_defun(ctx, env, list, RUNI_FUNCTION);
 }
 
-struct runi_object *runi_prim_define(struct runi_object *env, struct runi_object *list) {
-    if (runi_list_length(list) != 2 || list->car->type != RUNI_SYMBOL)
-        runi_error("Malformed setq");
+struct runi_object *runi_prim_defmemo(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    int limit = ctx->memo_limit;
+    if (runi_type(list) == RUNI_LIST && runi_type(list->cdr) == RUNI_LIST && runi_type(list->cdr->car) == RUNI_INTEGER) {
+        int64_t n = runi_fixnum_value(list->cdr->car);
+        if (n < 1 || n > INT_MAX)
+            runi_error(ctx, "defmemo: cache limit must be positive");
+        limit = n;
+        list = runi_cons(ctx, list->car, list->cdr->cdr);
+    }
+    struct runi_object *fn = runi_handle_defun(ctx, env, list, RUNI_FUNCTION);
+    fn->memo = runi_make_memo(ctx, limit);
+    return fn;
+}
+
+struct runi_object *runi_prim_define(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    if (runi_list_length(ctx, list) != 2 || runi_type(list->car) != RUNI_SYMBOL)
+        runi_error(ctx, "Malformed setq");
     struct runi_object *sym = list->car;
-    struct runi_object *value = runi_eval(env, list->cdr->car);
-    runi_add_variable(env, sym, value);
+    struct runi_object *value = runi_eval(ctx, env, list->cdr->car);
+    runi_add_variable(ctx, env, sym, value);
     return value;
 }
 
-struct runi_object *runi_prim_defmacro(struct runi_object *env, struct runi_object *list) {
-    return runi_handle_defun(env, list, RUNI_MACRO);
+struct runi_object *runi_prim_defmacro(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    runi_expansion_clear(ctx);
+    return runi_handle_defun(ctx, env, list, RUNI_MACRO);
 }
 
-struct runi_object *runi_prim_macroexpand(struct runi_object *env, struct runi_object *list) {
-    if (runi_list_length(list) != 1)
-        runi_error("Malformed macroexpand");
+struct runi_object *runi_prim_macroexpand(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    if (runi_list_length(ctx, list) != 1)
+        runi_error(ctx, "Malformed macroexpand");
     struct runi_object *body = list->car;
-    return runi_macroexpand(env, body);
+    return runi_macroexpand(ctx, env, body);
 }
 
-struct runi_object *runi_prim_println(struct runi_object *env, struct runi_object *list) {
-    runi_print(runi_eval(env, list->car));
-    printf("\n");
+struct runi_object *runi_prim_println(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    runi_print(ctx, argv[0]);
+    ctx->output(ctx->output_data, "\n", 1);
     return runi_nil;
 }
 
-struct runi_object *runi_prim_if(struct runi_object *env, struct runi_object *list) {
-    if (runi_list_length(list) < 2)
-        runi_error("Malformed if");
-    struct runi_object *cond = runi_eval(env, list->car);
-    if (cond != runi_nil) {
-        struct runi_object *then = list->cdr->car;
-        return runi_eval(env, then);
+static struct runi_object *runi_if_branch(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    if (runi_list_length(ctx, list) < 2)
+        runi_error(ctx, "Malformed if");
+    struct runi_object *cond = runi_eval(ctx, env, list->car);
+    if (cond != runi_nil)
+        return list->cdr->car;
+    return runi_progn_tail(ctx, env, list->cdr->cdr);
+}
+
+struct runi_object *runi_prim_if(struct runi_context *ctx, struct runi_object *env, struct runi_object *list) {
+    return runi_eval(ctx, env, runi_if_branch(ctx, env, list));
+}
+
+struct runi_object *runi_prim_num_eq(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    int64_t x = runi_check_integer(ctx, argv[0], "= only takes numbers");
+    int64_t y = runi_check_integer(ctx, argv[1], "= only takes numbers");
+    return x == y ? runi_true : runi_nil;
+}
+
+struct runi_object *runi_prim_lt(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    int64_t x = runi_check_integer(ctx, argv[0], "< only takes numbers");
+    int64_t y = runi_check_integer(ctx, argv[1], "< only takes numbers");
+    return x < y ? runi_true : runi_nil;
+}
+
+static struct runi_object *runi_check_string(struct runi_context *ctx, struct runi_object *obj, char *msg) {
+    if (runi_type(obj) != RUNI_STRING)
+        runi_error(ctx, "%s", msg);
+    return obj;
+}
+
+struct runi_object *runi_prim_string_length(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    return runi_make_integer(ctx, runi_check_string(ctx, argv[0], "string-length takes a string")->nchars);
+}
+
+struct runi_object *runi_prim_substring(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    struct runi_object *str = runi_check_string(ctx, argv[0], "substring takes a string");
+    int64_t start = runi_check_integer(ctx, argv[1], "substring takes integer indexes");
+    int64_t end = str->nchars;
+    if (argc == 3)
+        end = runi_check_integer(ctx, argv[2], "substring takes integer indexes");
+    if (start < 0 || end < start || (uint64_t)end > str->nchars)
+        runi_error(ctx, "substring: index out of range");
+    return runi_make_substring(ctx, str, start, end);
+}
+
+struct runi_object *runi_prim_string_append(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    size_t len = 0;
+    for (int i = 0; i < argc; i++)
+        len += runi_check_string(ctx, argv[i], "string-append takes only strings")->nchars;
+    if (argc == 1)
+        return argv[0];
+    struct runi_object *r = runi_alloc_string(ctx, len);
+    char *p = r->bytes;
+    for (int i = 0; i < argc; i++) {
+        memcpy(p, argv[i]->chars, argv[i]->nchars);
+        p += argv[i]->nchars;
+    }
+    return r;
+}
+
+struct runi_object *runi_prim_string_eq(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    struct runi_object *x = runi_check_string(ctx, argv[0], "string= takes only strings");
+    struct runi_object *y = runi_check_string(ctx, argv[1], "string= takes only strings");
+    return x->nchars == y->nchars && memcmp(x->chars, y->chars, x->nchars) == 0 ? runi_true : runi_nil;
+}
+
+struct runi_object *runi_prim_string_search(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    struct runi_object *needle = runi_check_string(ctx, argv[0], "string-search takes strings");
+    struct runi_object *haystack = runi_check_string(ctx, argv[1], "string-search takes strings");
+    int64_t start = 0;
+    if (argc == 3)
+        start = runi_check_integer(ctx, argv[2], "string-search takes an integer start");
+    if (start < 0 || (uint64_t)start > haystack->nchars)
+        runi_error(ctx, "string-search: index out of range");
+    const char *s = haystack->chars + start;
+    size_t len = haystack->nchars - start;
+    const char *found;
+    if (needle->nchars == 1)
+        found = memchr(s, needle->chars[0], len);
+    else
+        found = memmem(s, len, needle->chars, needle->nchars);
+    return found ? runi_make_integer(ctx, found - haystack->chars) : runi_nil;
+}
+
+static struct runi_object *runi_check_vector(struct runi_context *ctx, struct runi_object *obj, char *msg) {
+    if (runi_type(obj) != RUNI_VECTOR)
+        runi_error(ctx, "%s", msg);
+    return obj;
+}
+
+static size_t runi_check_index(struct runi_context *ctx, struct runi_object *obj, struct runi_object *v, char *msg) {
+    int64_t i = runi_check_integer(ctx, obj, msg);
+    if (i < 0 || (uint64_t)i >= v->nitems)
+        runi_error(ctx, "Vector index out of range: %lld", (long long)i);
+    return i;
+}
+
+struct runi_object *runi_prim_make_vector(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    int64_t len = runi_check_integer(ctx, argv[0], "make-vector takes an integer length");
+    if (len < 0)
+        runi_error(ctx, "make-vector: negative length");
+    return runi_make_vector(ctx, len, argc == 2 ? argv[1] : runi_nil);
+}
+
+struct runi_object *runi_prim_vector_ref(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    struct runi_object *v = runi_check_vector(ctx, argv[0], "vector-ref takes a vector");
+    return v->items[runi_check_index(ctx, argv[1], v, "vector-ref takes an integer index")];
+}
+
+struct runi_object *runi_prim_vector_set(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    struct runi_object *v = runi_check_vector(ctx, argv[0], "vector-set! takes a vector");
+    size_t i = runi_check_index(ctx, argv[1], v, "vector-set! takes an integer index");
+    return v->items[i] = argv[2];
+}
+
+struct runi_object *runi_prim_vector_length(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    return runi_make_integer(ctx, runi_check_vector(ctx, argv[0], "vector-length takes a vector")->nitems);
+}
+
+struct runi_object *runi_prim_vector_map(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)argc;
+    struct runi_object *fn = argv[0];
+    struct runi_object *v = runi_check_vector(ctx, argv[1], "vector-map takes a vector");
+    struct runi_object *r = runi_make_vector(ctx, v->nitems, runi_nil);
+    for (size_t i = 0; i < v->nitems; i++)
+        r->items[i] = runi_funcall(ctx, env, fn, 1, &v->items[i]);
+    return r;
+}
+
+struct runi_object *runi_prim_vector_fold(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)argc;
+    struct runi_object *fn = argv[0];
+    struct runi_object *acc = argv[1];
+    struct runi_object *v = runi_check_vector(ctx, argv[2], "vector-fold takes a vector");
+    for (size_t i = 0; i < v->nitems; i++) {
+        struct runi_object *args[2] = { acc, v->items[i] };
+        acc = runi_funcall(ctx, env, fn, 2, args);
     }
-    struct runi_object *els = list->cdr->cdr;
-    return els == runi_nil ? runi_nil : runi_progn(env, els);
+    return acc;
 }
 
-struct runi_object *runi_prim_num_eq(struct runi_object *env, struct runi_object *list) {
-    if (runi_list_length(list) != 2)
-        runi_error("Malformed =");
-    struct runi_object *values = runi_eval_list(env, list);
-    struct runi_object *x = values->car;
-    struct runi_object *y = values->cdr->car;
-    if (x->type != RUNI_INTEGER || y->type != RUNI_INTEGER)
-        runi_error("= only takes numbers");
-    return x->integer == y->integer ? runi_true : runi_nil;
+static struct runi_object *runi_check_hashtable(struct runi_context *ctx, struct runi_object *obj, char *msg) {
+    if (runi_type(obj) != RUNI_HASHTABLE)
+        runi_error(ctx, "%s", msg);
+    return obj;
 }
 
-struct runi_object *runi_prim_exit(struct runi_object *env, struct runi_object *list) {
+struct runi_object *runi_prim_make_hash_table(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    struct runi_object *test = argc == 1 ? argv[0] : runi_intern(ctx, "eq");
+    if (test == runi_intern(ctx, "eq"))
+        return runi_make_hashtable(ctx, RUNI_HASH_EQ);
+    if (test == runi_intern(ctx, "equal"))
+        return runi_make_hashtable(ctx, RUNI_HASH_EQUAL);
+    runi_error(ctx, "make-hash-table: test must be eq or equal");
+}
+
+struct runi_object *runi_prim_gethash(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    struct runi_object *table = runi_check_hashtable(ctx, argv[1], "gethash takes a hash table");
+    struct runi_object *value = runi_hashtable_get(table, argv[0]);
+    if (value)
+        return value;
+    return argc == 3 ? argv[2] : runi_nil;
+}
+
+struct runi_object *runi_prim_puthash(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    struct runi_object *table = runi_check_hashtable(ctx, argv[2], "puthash takes a hash table");
+    runi_hashtable_put(ctx, table, argv[0], argv[1]);
+    return argv[1];
+}
+
+struct runi_object *runi_prim_remhash(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    struct runi_object *table = runi_check_hashtable(ctx, argv[1], "remhash takes a hash table");
+    return runi_hashtable_remove(table, argv[0]) ? runi_true : runi_nil;
+}
+
+struct runi_object *runi_prim_hash_count(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    return runi_make_integer(ctx, runi_check_hashtable(ctx, argv[0], "hash-count takes a hash table")->hcount);
+}
+
+struct runi_object *runi_prim_hcons(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    return runi_hcons(ctx, argv[0], argv[1]);
+}
+
+static struct runi_object *runi_sequence_vector(struct runi_context *ctx, struct runi_object *seq, char *msg) {
+    if (runi_type(seq) == RUNI_VECTOR)
+        return seq;
+    if (!runi_is_list(seq))
+        runi_error(ctx, "%s", msg);
+    struct runi_object *v = runi_make_vector(ctx, runi_list_length(ctx, seq), runi_nil);
+    for (size_t i = 0; i < v->nitems; i++, seq = seq->cdr)
+        v->items[i] = seq->car;
+    return v;
+}
+
+struct runi_object *runi_prim_pmap(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)argc;
+    struct runi_object *seq = argv[1];
+    struct runi_object *results = runi_parallel_map(ctx, env, argv[0], runi_sequence_vector(ctx, seq, "pmap takes a list or a vector"));
+    if (runi_type(seq) == RUNI_VECTOR)
+        return results;
+    struct runi_object *r = runi_nil;
+    for (size_t i = results->nitems; i > 0; i--)
+        r = runi_cons(ctx, results->items[i - 1], r);
+    return r;
+}
+
+struct runi_object *runi_prim_preduce(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)argc;
+    return runi_parallel_reduce(ctx, env, argv[0], argv[1], runi_sequence_vector(ctx, argv[2], "preduce takes a list or a vector"));
+}
+
+struct runi_object *runi_prim_save_image(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)argc;
+    struct runi_object *path = argv[0];
+    if (runi_type(path) != RUNI_STRING)
+        runi_error(ctx, "save-image takes a file name");
+    while (env->parent)
+        env = env->parent;
+    runi_save_image(ctx, env, runi_string_cstr(ctx, path));
+    return runi_true;
+}
+
+struct runi_object *runi_prim_load(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)argc;
+    struct runi_object *path = argv[0];
+    if (runi_type(path) != RUNI_STRING)
+        runi_error(ctx, "load takes a file name");
+    while (env->parent)
+        env = env->parent;
+    runi_load(ctx, env, runi_string_cstr(ctx, path));
+    return runi_true;
+}
+
+#ifdef RUNI_STATS
+static const char *runi_type_names[RUNI_NTYPES] = {
+    [RUNI_INTEGER] = "integer", [RUNI_LIST] = "list", [RUNI_SYMBOL] = "symbol",
+    [RUNI_STRING] = "string", [RUNI_PRIMITIVE] = "primitive", [RUNI_FUNCTION] = "function",
+    [RUNI_MACRO] = "macro", [RUNI_ENV] = "env", [RUNI_NIL] = "nil", [RUNI_DOT] = "dot",
+    [RUNI_CPAREN] = "cparen", [RUNI_TRUE] = "true", [RUNI_FRAME] = "frame",
+    [RUNI_LOCALREF] = "localref", [RUNI_GLOBALREF] = "globalref", [RUNI_CODE] = "code",
+    [RUNI_VECTOR] = "vector", [RUNI_HASHTABLE] = "hashtable",
+};
+
+static struct runi_object *runi_stats_by_type(struct runi_context *ctx, char *name, size_t *counts) {
+    struct runi_object *alist = runi_nil;
+    for (int i = RUNI_NTYPES - 1; i > 0; i--)
+        if (counts[i])
+            alist = runi_acons(ctx, runi_intern(ctx, (char *)runi_type_names[i]), runi_make_integer(ctx, counts[i]), alist);
+    return runi_cons(ctx, runi_intern(ctx, name), alist);
+}
+
+static struct runi_object *runi_stats_count(struct runi_context *ctx, char *name, size_t count, struct runi_object *alist) {
+    return runi_acons(ctx, runi_intern(ctx, name), runi_make_integer(ctx, count), alist);
+}
+#endif
+
+struct runi_object *runi_prim_stats(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)ctx;
+    (void)env;
+    (void)argc;
+    (void)argv;
+#ifdef RUNI_STATS
+    struct runi_stats *s = &ctx->stats;
+    struct runi_object *prims = runi_nil;
+    for (size_t i = 0; i < ctx->symtab_cap; i++) {
+        struct runi_object *sym = ctx->symtab[i].sym;
+        if (sym && sym->value && runi_type(sym->value) == RUNI_PRIMITIVE)
+            prims = runi_acons(ctx, sym, runi_make_integer(ctx, sym->value->ncalls), prims);
+    }
+    struct runi_object *r = runi_stats_count(ctx, "max-eval-depth", s->max_eval_depth, runi_nil);
+    r = runi_cons(ctx, runi_cons(ctx, runi_intern(ctx, "primitive-calls"), prims), r);
+    r = runi_cons(ctx, runi_stats_by_type(ctx, "alloc-bytes", s->alloc_bytes), r);
+    r = runi_cons(ctx, runi_stats_by_type(ctx, "alloc-objects", s->alloc_objects), r);
+    r = runi_stats_count(ctx, "macroexpand-hits", s->macroexpand_hits, r);
+    r = runi_stats_count(ctx, "macroexpand-calls", s->macroexpand_calls, r);
+    r = runi_stats_count(ctx, "find-average-chain", s->find_calls ? s->find_steps / s->find_calls : 0, r);
+    r = runi_stats_count(ctx, "find-steps", s->find_steps, r);
+    r = runi_stats_count(ctx, "find-calls", s->find_calls, r);
+    return runi_cons(ctx, runi_stats_by_type(ctx, "eval-calls", s->eval_calls), r);
+#else
+    return runi_nil;
+#endif
+}
+
+struct runi_object *runi_prim_profile_start(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    (void)argv;
+    runi_profile_start(ctx);
+    return runi_true;
+}
+
+struct runi_object *runi_prim_profile_stop(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)env;
+    (void)argc;
+    struct runi_object *path = argv[0];
+    if (runi_type(path) != RUNI_STRING)
+        runi_error(ctx, "profile-stop takes a file name");
+    return runi_make_integer(ctx, runi_profile_stop(ctx, runi_string_cstr(ctx, path)));
+}
+
+struct runi_object *runi_prim_exit(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv) {
+    (void)ctx;
+    (void)env;
+    (void)argc;
+    (void)argv;
     exit(EXIT_SUCCESS);
 }
 
-void runi_add_primitive(struct runi_object *env, char *name, runi_primitive *fn) {
-    struct runi_object *sym = runi_intern(name);
-    struct runi_object *prim = runi_make_primitive(fn);
-    runi_add_variable(env, sym, prim);
+void runi_add_primitive(struct runi_context *ctx, struct runi_object *env, char *name, runi_primitive *fn) {
+    struct runi_object *sym = runi_intern(ctx, name);
+    struct runi_object *prim = runi_make_primitive(ctx, fn);
+    runi_add_variable(ctx, env, sym, prim);
+}
+
+void runi_add_argv_primitive(struct runi_context *ctx, struct runi_object *env, char *name, runi_argv_primitive *fn, int min_args, int max_args) {
+    struct runi_object *sym = runi_intern(ctx, name);
+    struct runi_object *prim = runi_make_argv_primitive(ctx, sym->name, fn, min_args, max_args);
+    runi_add_variable(ctx, env, sym, prim);
+}
+
+void runi_add_primitives(struct runi_context *ctx, struct runi_object *env) {
+    runi_add_variable(ctx, env, runi_intern(ctx, "t"), runi_true);
+    runi_add_primitive(ctx, env, "quote", runi_prim_quote);
+    runi_add_argv_primitive(ctx, env, "list", runi_prim_list, 0, RUNI_VARARGS);
+    runi_add_argv_primitive(ctx, env, "cons", runi_prim_cons, 2, 2);
+    runi_add_argv_primitive(ctx, env, "car", runi_prim_car, 1, 1);
+    runi_add_argv_primitive(ctx, env, "cdr", runi_prim_cdr, 1, 1);
+    runi_add_primitive(ctx, env, "setq", runi_prim_setq);
+    runi_add_argv_primitive(ctx, env, "+", runi_prim_plus, 0, RUNI_VARARGS);
+    runi_add_argv_primitive(ctx, env, "-", runi_prim_minus, 1, RUNI_VARARGS);
+    runi_add_primitive(ctx, env, "define", runi_prim_define);
+    runi_add_primitive(ctx, env, "defun", runi_prim_defun);
+    runi_add_primitive(ctx, env, "defmemo", runi_prim_defmemo);
+    runi_add_primitive(ctx, env, "defmacro", runi_prim_defmacro);
+    runi_add_primitive(ctx, env, "macroexpand", runi_prim_macroexpand);
+    runi_add_primitive(ctx, env, "lambda", runi_prim_lambda);
+    runi_add_primitive(ctx, env, "if", runi_prim_if);
+    runi_add_argv_primitive(ctx, env, "=", runi_prim_num_eq, 2, 2);
+    runi_add_argv_primitive(ctx, env, "<", runi_prim_lt, 2, 2);
+    runi_add_argv_primitive(ctx, env, "println", runi_prim_println, 1, 1);
+    runi_add_argv_primitive(ctx, env, "string-length", runi_prim_string_length, 1, 1);
+    runi_add_argv_primitive(ctx, env, "substring", runi_prim_substring, 2, 3);
+    runi_add_argv_primitive(ctx, env, "string-append", runi_prim_string_append, 0, RUNI_VARARGS);
+    runi_add_argv_primitive(ctx, env, "string=", runi_prim_string_eq, 2, 2);
+    runi_add_argv_primitive(ctx, env, "string-search", runi_prim_string_search, 2, 3);
+    runi_add_argv_primitive(ctx, env, "make-vector", runi_prim_make_vector, 1, 2);
+    runi_add_argv_primitive(ctx, env, "vector-ref", runi_prim_vector_ref, 2, 2);
+    runi_add_argv_primitive(ctx, env, "vector-set!", runi_prim_vector_set, 3, 3);
+    runi_add_argv_primitive(ctx, env, "vector-length", runi_prim_vector_length, 1, 1);
+    runi_add_argv_primitive(ctx, env, "vector-map", runi_prim_vector_map, 2, 2);
+    runi_add_argv_primitive(ctx, env, "vector-fold", runi_prim_vector_fold, 3, 3);
+    runi_add_argv_primitive(ctx, env, "make-hash-table", runi_prim_make_hash_table, 0, 1);
+    runi_add_argv_primitive(ctx, env, "gethash", runi_prim_gethash, 2, 3);
+    runi_add_argv_primitive(ctx, env, "puthash", runi_prim_puthash, 3, 3);
+    runi_add_argv_primitive(ctx, env, "remhash", runi_prim_remhash, 2, 2);
+    runi_add_argv_primitive(ctx, env, "hash-count", runi_prim_hash_count, 1, 1);
+    runi_add_argv_primitive(ctx, env, "hcons", runi_prim_hcons, 2, 2);
+    runi_add_argv_primitive(ctx, env, "pmap", runi_prim_pmap, 2, 2);
+    runi_add_argv_primitive(ctx, env, "preduce", runi_prim_preduce, 3, 3);
+    runi_add_argv_primitive(ctx, env, "save-image", runi_prim_save_image, 1, 1);
+    runi_add_argv_primitive(ctx, env, "load", runi_prim_load, 1, 1);
+    runi_add_argv_primitive(ctx, env, "runi-stats", runi_prim_stats, 0, 0);
+    runi_add_argv_primitive(ctx, env, "profile-start", runi_prim_profile_start, 0, 0);
+    runi_add_argv_primitive(ctx, env, "profile-stop", runi_prim_profile_stop, 1, 1);
+    runi_add_argv_primitive(ctx, env, "exit", runi_prim_exit, 0, RUNI_VARARGS);
 }
@@ -1,6 +1,18 @@
 #ifndef RUNI_LISP_H
 #define RUNI_LISP_H
-#define RUNI_SYMBOL_MAX_LEN 200
+#define RUNI_DEFAULT_HEAP_SIZE (64 * 1024 * 1024)
+#define RUNI_DEFAULT_MAX_EVAL_DEPTH 20000
+#define RUNI_DEFAULT_MEMO_LIMIT 4096
+#define RUNI_READER_BUFSIZE (64 * 1024)
+#define RUNI_PROF_MAX_DEPTH 256
+#define RUNI_PROF_INTERVAL_US 1000
+#define RUNI_HASH_MIN_CAP 8
+#define RUNI_JIT_MAX_ARGS 8
+#define RUNI_ARGV_STACK 16
+#define RUNI_VARARGS -1
+#define RUNI_FIXNUM_TAG 1
+#define RUNI_FIXNUM_MAX ((INT64_C(1) << 61) - 1)
+#define RUNI_FIXNUM_MIN (-RUNI_FIXNUM_MAX - 1)
 
 #include <stddef.h>
 #include <stdarg.h>
@@ -10,6 +22,9 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <pthread.h>
 
 enum {
     RUNI_INTEGER = 1,
@@ -24,104 +39,551 @@ enum {
     RUNI_DOT,
     RUNI_CPAREN,
     RUNI_TRUE,
+    RUNI_FRAME,
+    RUNI_LOCALREF,
+    RUNI_GLOBALREF,
+    RUNI_CODE,
+    RUNI_VECTOR,
+    RUNI_HASHTABLE,
+    RUNI_NTYPES,
+};
+
+enum {
+    RUNI_HASH_EQ,
+    RUNI_HASH_EQUAL,
+    RUNI_HASH_CONS,
+};
+
+enum {
+    RUNI_OP_CONST,
+    RUNI_OP_LOCAL,
+    RUNI_OP_OUTER,
+    RUNI_OP_SETLOCAL,
+    RUNI_OP_SETOUTER,
+    RUNI_OP_GLOBAL,
+    RUNI_OP_EVAL,
+    RUNI_OP_CALLEE,
+    RUNI_OP_CHECKFN,
+    RUNI_OP_BUILTIN,
+    RUNI_OP_GUARD,
+    RUNI_OP_CALL,
+    RUNI_OP_TAILCALL,
+    RUNI_OP_ADD,
+    RUNI_OP_SUB,
+    RUNI_OP_NUMEQ,
+    RUNI_OP_LT,
+    RUNI_OP_JUMP,
+    RUNI_OP_JUMPNIL,
+    RUNI_OP_POP,
+    RUNI_OP_RET,
 };
 
 struct runi_object;
+struct runi_context;
+struct runi_par_job;
+struct runi_par_pool;
+
+#define runi_is_fixnum(obj) (((uintptr_t)(obj) & 3) == RUNI_FIXNUM_TAG)
+#define runi_fixnum(n) ((struct runi_object *)(((uintptr_t)(int64_t)(n) << 2) | RUNI_FIXNUM_TAG))
+#define runi_fixnum_value(obj) ((int64_t)(intptr_t)(obj) >> 2)
+#define runi_type(obj) (runi_is_fixnum(obj) ? RUNI_INTEGER : (obj)->type)
+
+#define runi_prof_push(ctx, fn) do {                        \
+        size_t runi_prof_len = (ctx)->prof_len;             \
+        if (runi_prof_len < RUNI_PROF_MAX_DEPTH)            \
+            (ctx)->prof_stack[runi_prof_len] = (fn)->fname; \
+        (ctx)->prof_len = runi_prof_len + 1;                \
+    } while (0)
+
+#ifdef RUNI_STATS
+#define RUNI_STAT(stmt) do { stmt; } while (0)
+#else
+#define RUNI_STAT(stmt) do { } while (0)
+#endif
+
+typedef struct runi_object *runi_primitive(struct runi_context *ctx, struct runi_object *env, struct runi_object *args);
+
+typedef struct runi_object *runi_argv_primitive(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-typedef struct runi_object *runi_primitive(struct runi_object *env, struct runi_object *args);
+typedef struct runi_object *runi_native(struct runi_context *ctx, struct runi_object **argv);
+
+typedef void runi_print_sink(void *data, const char *buf, size_t len);
 
 struct runi_object {
     int type;
+    int flags;
 
     union {
-        int integer;
-
         struct {
             struct runi_object *car;
             struct runi_object *cdr;
         };
 
-        char name[1];
+        struct {
+            struct runi_object *value;
+            char name[1];
+        };
 
-        char string[1];
+        struct {
+            const char *chars;
+            size_t nchars;
+            struct runi_object *base;
+            char bytes[1];
+        };
 
-        runi_primitive *fn;
+        struct {
+            runi_primitive *fn;
+            size_t ncalls;
+            runi_argv_primitive *afn;
+            const char *pname;
+            int min_args;
+            int max_args;
+        };
 
         struct {
             struct runi_object *env;
             struct runi_object *args;
             struct runi_object *body;
+            struct runi_object *code;
+            struct runi_object *fname;
+            struct runi_object *source;
+            struct runi_object *deps;
+            struct runi_object *memo;
+            unsigned long depoch;
+            runi_native *native;
+            long calls;
+        };
+
+        struct {
+            int ncode;
+            int nconsts;
+            int nstack;
+            int nparams;
+            struct runi_object *consts[1];
         };
 
         struct {
             struct runi_object *vars;
             struct runi_object *parent;
+            struct runi_object *params;
+            size_t nslots;
+            struct runi_object *slots[1];
+        };
+
+        struct {
+            size_t nitems;
+            struct runi_object *items[1];
+        };
+
+        struct {
+            struct runi_object *buckets;
+            struct runi_object *old_buckets;
+            size_t hcount;
+            size_t hused;
+            size_t hmigrated;
+            int htest;
+        };
+
+        struct {
+            struct runi_object *symbol;
+            int depth;
+            int index;
+            struct runi_object *cache;
+            unsigned long epoch;
         };
     };
 };
 
-extern struct runi_object *runi_nil;
-extern struct runi_object *runi_dot;
-extern struct runi_object *runi_cparen;
-extern struct runi_object *runi_true;
-extern struct runi_object *runi_symbols;
+struct runi_gc_stats {
+    size_t heap_size;
+    size_t live_bytes;
+    size_t live_objects;
+    size_t collections;
+    size_t total_allocated_bytes;
+    size_t total_allocated_objects;
+    size_t total_freed_bytes;
+    size_t total_freed_objects;
+    size_t chunks;
+    size_t arena_bytes;
+};
+
+struct runi_stats {
+    size_t eval_calls[RUNI_NTYPES];
+    size_t find_calls;
+    size_t find_steps;
+    size_t macroexpand_calls;
+    size_t macroexpand_hits;
+    size_t alloc_objects[RUNI_NTYPES];
+    size_t alloc_bytes[RUNI_NTYPES];
+    int max_eval_depth;
+};
+
+struct runi_reader {
+    const char *buf;
+    size_t len;
+    size_t pos;
+    size_t start;
+    int fd;
+    bool owns_fd;
+    char *data;
+    size_t cap;
+    void *map;
+};
+
+struct runi_symtab_entry {
+    uint32_t hash;
+    uint32_t len;
+    struct runi_object *sym;
+};
+
+struct runi_vm_call {
+    struct runi_object *code;
+    int32_t *ops;
+    int pc;
+    size_t bp;
+};
+
+struct runi_handler {
+    jmp_buf buf;
+    struct runi_handler *prev;
+    int eval_depth;
+    size_t vm_top;
+    size_t vm_ncalls;
+    size_t prof_len;
+    int jit_depth;
+};
+
+struct runi_context {
+    struct runi_arena *arenas;
+    struct runi_chunk *large_objects;
+    struct runi_chunk **chunk_table;
+    size_t chunk_table_len;
+    size_t chunk_table_cap;
+    struct runi_gc_stats gc_stats;
+    struct runi_object ***gc_roots;
+    size_t gc_roots_len;
+    size_t gc_roots_cap;
+    struct runi_gc_range *gc_ranges;
+    size_t gc_ranges_len;
+    struct runi_object **mark_stack;
+    size_t mark_stack_len;
+    size_t mark_stack_cap;
+    pthread_t stack_thread;
+    void *stack_top;
+    void *stack_low;
+    struct runi_context **gc_children;
+    int gc_nchildren;
+    int gc_inhibit;
+
+    struct runi_context *parent;
+    struct runi_par_job *job;
+    struct runi_par_pool *pool;
+    size_t child_bytes;
+    pthread_mutex_t symtab_lock;
+    struct runi_symtab_entry *symtab;
+    size_t symtab_len;
+    size_t symtab_cap;
+    struct runi_expansion *expansions;
+    size_t expansions_len;
+    size_t expansions_cap;
+    unsigned long global_epoch;
+
+    int max_eval_depth;
+    int eval_depth;
+    bool vm_enabled;
+    bool jit_enabled;
+    int nthreads;
+    int memo_limit;
+    struct runi_object *hcons;
+    struct runi_stats stats;
+    struct runi_object **vm_stack;
+    size_t vm_cap;
+    size_t vm_top;
+    struct runi_vm_call *vm_calls;
+    size_t vm_ncalls;
+    size_t vm_capcalls;
+    struct runi_object *volatile prof_stack[RUNI_PROF_MAX_DEPTH];
+    volatile size_t prof_len;
+    struct runi_object *jit_tail_fn;
+    int jit_tail_argc;
+    struct runi_object *jit_tail_args[RUNI_JIT_MAX_ARGS];
+    int jit_depth;
+    runi_native **jit_retired;
+    size_t jit_nretired;
+    size_t jit_capretired;
+
+    struct runi_reader input;
+    runi_print_sink *output;
+    void *output_data;
+    struct runi_handler *handler;
+    char error[256];
+};
+
+extern struct runi_object *const runi_nil;
+extern struct runi_object *const runi_dot;
+extern struct runi_object *const runi_cparen;
+extern struct runi_object *const runi_true;
+extern struct runi_object *const runi_lambda_marker;
+extern struct runi_object *const runi_guard_marker;
+
+struct runi_context *runi_context_new(size_t heap_size);
+
+void runi_context_free(struct runi_context *ctx);
+
+struct runi_context *runi_context_new_child(struct runi_context *parent);
+
+void runi_context_join(struct runi_context *parent, struct runi_context *child);
+
+void runi_push_handler(struct runi_context *ctx, struct runi_handler *h);
+
+void runi_pop_handler(struct runi_context *ctx, struct runi_handler *h);
+
+void __attribute((noreturn)) runi_error(struct runi_context *ctx, char *fmt, ...);
+
+void runi_gc_add_root(struct runi_context *ctx, struct runi_object **root);
+
+void runi_gc_add_range(struct runi_context *ctx, void ***base, size_t *len);
+
+void runi_gc_collect(struct runi_context *ctx);
+
+void runi_gc_collect_children(struct runi_context *ctx, struct runi_context **children, int n);
+
+void *runi_gc_stack_top(struct runi_context *ctx);
+
+void runi_gc_get_stats(struct runi_context *ctx, struct runi_gc_stats *stats);
+
+void runi_arena_trim(struct runi_context *ctx);
+
+struct runi_object *runi_make_integer(struct runi_context *ctx, int64_t integer);
+
+struct runi_object *runi_make_string_len(struct runi_context *ctx, const char *string, size_t len);
+
+struct runi_object *runi_make_string(struct runi_context *ctx, char *string);
+
+struct runi_object *runi_make_substring(struct runi_context *ctx, struct runi_object *str, size_t start, size_t end);
+
+const char *runi_string_cstr(struct runi_context *ctx, struct runi_object *str);
+
+struct runi_object *runi_make_function(struct runi_context *ctx, int type, struct runi_object *env, struct runi_object *args, struct runi_object *body);
+
+struct runi_object *runi_make_vector(struct runi_context *ctx, size_t nitems, struct runi_object *fill);
+
+struct runi_object *runi_make_hashtable(struct runi_context *ctx, int test);
+
+uint64_t runi_hash(struct runi_object *obj, int test);
+
+bool runi_equal(struct runi_object *a, struct runi_object *b);
+
+struct runi_object *runi_hashtable_get(struct runi_object *table, struct runi_object *key);
+
+void runi_hashtable_put(struct runi_context *ctx, struct runi_object *table, struct runi_object *key, struct runi_object *value);
+
+bool runi_hashtable_remove(struct runi_object *table, struct runi_object *key);
+
+void runi_hashtable_each(struct runi_object *table, void (*fn)(void *data, struct runi_object *key, struct runi_object *value), void *data);
+
+void runi_hashtable_prune(struct runi_object *table, bool (*live)(struct runi_object *key));
+
+struct runi_object *runi_make_env(struct runi_context *ctx, struct runi_object *vars, struct runi_object *parent);
+
+struct runi_object *runi_make_frame(struct runi_context *ctx, struct runi_object *parent, struct runi_object *params, size_t nslots);
+
+struct runi_object *runi_make_localref(struct runi_context *ctx, struct runi_object *symbol, int depth, int index);
+
+struct runi_object *runi_make_globalref(struct runi_context *ctx, struct runi_object *symbol);
+
+struct runi_object *runi_cons(struct runi_context *ctx, struct runi_object *car, struct runi_object *cdr);
+
+struct runi_object *runi_acons(struct runi_context *ctx, struct runi_object *x, struct runi_object *y, struct runi_object *a);
+
+void runi_reader_init_buffer(struct runi_reader *r, const char *buf, size_t len);
+
+void runi_reader_init_fd(struct runi_reader *r, int fd);
+
+bool runi_reader_open_file(struct runi_reader *r, const char *path);
+
+void runi_reader_close(struct runi_reader *r);
+
+struct runi_object *runi_read(struct runi_context *ctx, struct runi_reader *r);
+
+struct runi_object *runi_parse(struct runi_context *ctx);
+
+struct runi_object *runi_intern(struct runi_context *ctx, char *name);
+
+struct runi_object *runi_intern_len(struct runi_context *ctx, const char *name, size_t len);
+
+void runi_print(struct runi_context *ctx, struct runi_object *obj);
+
+void runi_print_to(struct runi_context *ctx, struct runi_object *obj, runi_print_sink *sink, void *data);
+
+char *runi_print_to_string(struct runi_context *ctx, struct runi_object *obj, size_t *len);
+
+void runi_add_variable(struct runi_context *ctx, struct runi_object *env, struct runi_object *sym, struct runi_object *val);
+
+struct runi_object **runi_find(struct runi_context *ctx, struct runi_object *env, struct runi_object *sym);
+
+int runi_list_length(struct runi_context *ctx, struct runi_object *list);
+
+struct runi_object *runi_progn(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+
+struct runi_object *runi_eval_list(struct runi_context *ctx, struct runi_object *env, struct runi_object *obj);
+
+struct runi_object *runi_eval(struct runi_context *ctx, struct runi_object *env, struct runi_object *obj);
+
+struct runi_object *runi_macroexpand(struct runi_context *ctx, struct runi_object *env, struct runi_object *obj);
+
+struct runi_object *runi_expansion_lookup(struct runi_context *ctx, struct runi_object *macro, struct runi_object *args);
+
+void runi_expansion_add(struct runi_context *ctx, struct runi_object *macro, struct runi_object *args, struct runi_object *expansion);
+
+struct runi_object *runi_eval_globalref(struct runi_context *ctx, struct runi_object *env, struct runi_object *ref);
+
+struct runi_object *runi_apply(struct runi_context *ctx, struct runi_object *env, struct runi_object *fn, struct runi_object *args);
+
+struct runi_object *runi_funcall(struct runi_context *ctx, struct runi_object *env, struct runi_object *fn, int argc, struct runi_object **argv);
+
+struct runi_object *runi_function_body(struct runi_context *ctx, struct runi_object *fn);
+
+struct runi_object *runi_invoke(struct runi_context *ctx, struct runi_object *fn, struct runi_object *frame);
+
+void runi_save_image(struct runi_context *ctx, struct runi_object *env, const char *path);
+
+void runi_load_image(struct runi_context *ctx, struct runi_object *env, const char *path);
+
+void runi_load(struct runi_context *ctx, struct runi_object *env, const char *path);
+
+void runi_profile_start(struct runi_context *ctx);
+
+long runi_profile_stop(struct runi_context *ctx, const char *path);
+
+struct runi_object *runi_parallel_map(struct runi_context *ctx, struct runi_object *env, struct runi_object *fn, struct runi_object *items);
+
+struct runi_object *runi_parallel_reduce(struct runi_context *ctx, struct runi_object *env, struct runi_object *fn, struct runi_object *init, struct runi_object *items);
+
+void runi_par_safepoint(struct runi_context *ctx);
+
+void runi_par_lock(struct runi_context *ctx, pthread_mutex_t *lock);
+
+void runi_par_pool_free(struct runi_context *ctx);
+
+struct runi_object *runi_make_memo(struct runi_context *ctx, int limit);
+
+struct runi_object *runi_memo_call(struct runi_context *ctx, struct runi_object *fn, struct runi_object *frame);
+
+struct runi_object *runi_hcons(struct runi_context *ctx, struct runi_object *car, struct runi_object *cdr);
+
+struct runi_object *runi_make_code(struct runi_context *ctx, int ncode, int nconsts, int nstack, int nparams);
+
+int32_t *runi_code_ops(struct runi_object *code);
+
+bool runi_vm_compile(struct runi_context *ctx, struct runi_object *fn);
+
+struct runi_object *runi_vm_execute(struct runi_context *ctx, struct runi_object *fn, struct runi_object *frame);
+
+struct runi_object *runi_vm_arith(struct runi_context *ctx, int op, int argc, struct runi_object **argv);
+
+bool runi_jit_ready(struct runi_context *ctx, struct runi_object *fn);
+
+struct runi_object *runi_jit_call(struct runi_context *ctx, struct runi_object *fn, struct runi_object **argv);
+
+struct runi_object *runi_jit_enter(struct runi_context *ctx, struct runi_object *fn, struct runi_object **argv);
+
+void runi_jit_retire(struct runi_context *ctx, runi_native *native);
+
+void runi_jit_free(runi_native *native);
+
+struct runi_object *runi_prim_quote(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+
+struct runi_object *runi_prim_list(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
+
+struct runi_object *runi_prim_cons(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
+
+struct runi_object *runi_prim_car(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
+
+struct runi_object *runi_prim_cdr(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
+
+struct runi_object *runi_prim_setq(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+
+struct runi_object *runi_prim_plus(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
+
+struct runi_object *runi_prim_minus(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
+
+struct runi_object *runi_prim_lambda(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+
+struct runi_object *runi_handle_defun(struct runi_context *ctx, struct runi_object *env, struct runi_object *list, int type);
+
+struct runi_object *runi_prim_defun(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+
+struct runi_object *runi_prim_define(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+
+struct runi_object *runi_prim_defmemo(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+
+struct runi_object *runi_prim_defmacro(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+
+struct runi_object *runi_prim_macroexpand(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+
+struct runi_object *runi_prim_println(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
+
+struct runi_object *runi_prim_if(struct runi_context *ctx, struct runi_object *env, struct runi_object *list);
+
+struct runi_object *runi_prim_num_eq(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-void __attribute((noreturn)) runi_error(char *fmt, ...);
+struct runi_object *runi_prim_lt(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_make_special(int type);
+struct runi_object *runi_prim_string_length(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_make_integer(int integer);
+struct runi_object *runi_prim_substring(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_make_string(char *string);
+struct runi_object *runi_prim_string_append(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_make_env(struct runi_object *vars, struct runi_object *parent);
+struct runi_object *runi_prim_string_eq(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_cons(struct runi_object *car, struct runi_object *cdr);
+struct runi_object *runi_prim_string_search(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_acons(struct runi_object *x, struct runi_object *y, struct runi_object *a);
+struct runi_object *runi_prim_make_vector(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_parse(void);
+struct runi_object *runi_prim_vector_ref(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_intern(char *name);
+struct runi_object *runi_prim_vector_set(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-void runi_print(struct runi_object *obj);
+struct runi_object *runi_prim_vector_length(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-void runi_add_variable(struct runi_object *env, struct runi_object *sym, struct runi_object *val);
+struct runi_object *runi_prim_vector_map(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_find(struct runi_object *env, struct runi_object *sym);
+struct runi_object *runi_prim_vector_fold(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_eval_list(struct runi_object *env, struct runi_object *obj);
+struct runi_object *runi_prim_make_hash_table(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_eval(struct runi_object *env, struct runi_object *obj);
+struct runi_object *runi_prim_gethash(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_quote(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_puthash(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_list(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_remhash(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_setq(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_hash_count(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_plus(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_hcons(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_lambda(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_pmap(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_handle_defun(struct runi_object *env, struct runi_object *list, int type);
+struct runi_object *runi_prim_preduce(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_defun(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_save_image(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_define(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_load(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_defmacro(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_stats(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_macroexpand(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_profile_start(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_println(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_profile_stop(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_if(struct runi_object *env, struct runi_object *list);
+struct runi_object *runi_prim_exit(struct runi_context *ctx, struct runi_object *env, int argc, struct runi_object **argv);
 
-struct runi_object *runi_prim_num_eq(struct runi_object *env, struct runi_object *list);
+void runi_add_primitive(struct runi_context *ctx, struct runi_object *env, char *name, runi_primitive *fn);
 
-struct runi_object *runi_prim_exit(struct runi_object *env, struct runi_object *list);
+void runi_add_argv_primitive(struct runi_context *ctx, struct runi_object *env, char *name, runi_argv_primitive *fn, int min_args, int max_args);
 
-void runi_add_primitive(struct runi_object *env, char *name, runi_primitive *fn);
+void runi_add_primitives(struct runi_context *ctx, struct runi_object *env);
 
 #endif
@@ -0,0 +1,112 @@
+#include "runi_lisp.h"
+
+enum { MEMO_TABLE, MEMO_RING, MEMO_LIMIT, MEMO_LOCK, MEMO_SIZE };
+
+enum { NODE_KEY, NODE_VALUE, NODE_PREV, NODE_NEXT, NODE_SIZE };
+
+static void unlink_node(struct runi_object *node) {
+    node->items[NODE_PREV]->items[NODE_NEXT] = node->items[NODE_NEXT];
+    node->items[NODE_NEXT]->items[NODE_PREV] = node->items[NODE_PREV];
+    node->items[NODE_PREV] = node->items[NODE_NEXT] = runi_nil;
+}
+
+static void push_front(struct runi_object *ring, struct runi_object *node) {
+    node->items[NODE_PREV] = ring;
+    node->items[NODE_NEXT] = ring->items[NODE_NEXT];
+    ring->items[NODE_NEXT]->items[NODE_PREV] = node;
+    ring->items[NODE_NEXT] = node;
+}
+
+struct runi_object *runi_make_memo(struct runi_context *ctx, int limit) {
+    if (limit < 1)
+        runi_error(ctx, "defmemo: cache limit must be positive");
+    struct runi_object *memo = runi_make_vector(ctx, MEMO_SIZE, runi_nil);
+    memo->items[MEMO_TABLE] = runi_make_hashtable(ctx, RUNI_HASH_EQUAL);
+    struct runi_object *ring = runi_make_vector(ctx, NODE_SIZE, runi_nil);
+    ring->items[NODE_PREV] = ring->items[NODE_NEXT] = ring;
+    memo->items[MEMO_RING] = ring;
+    memo->items[MEMO_LIMIT] = runi_make_integer(ctx, limit);
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    memo->items[MEMO_LOCK] = runi_make_string_len(ctx, (const char *)&mutex, sizeof(mutex));
+    return memo;
+}
+
+static pthread_mutex_t *memo_lock(struct runi_object *memo) {
+    return (pthread_mutex_t *)memo->items[MEMO_LOCK]->bytes;
+}
+
+static void lock(struct runi_context *ctx, struct runi_object *memo) {
+    if (ctx->parent)
+        runi_par_lock(ctx, memo_lock(memo));
+}
+
+static void unlock(struct runi_context *ctx, struct runi_object *memo) {
+    if (ctx->parent)
+        pthread_mutex_unlock(memo_lock(memo));
+}
+
+static struct runi_object *lookup(struct runi_context *ctx, struct runi_object *memo, struct runi_object *key) {
+    lock(ctx, memo);
+    struct runi_object *node = runi_hashtable_get(memo->items[MEMO_TABLE], key);
+    if (node && node->items[NODE_NEXT] == runi_nil)
+        node = NULL;
+    if (node) {
+        unlink_node(node);
+        push_front(memo->items[MEMO_RING], node);
+    }
+    unlock(ctx, memo);
+    return node;
+}
+
+static void store(struct runi_context *ctx, struct runi_object *memo, struct runi_object *node) {
+    struct runi_object *table = memo->items[MEMO_TABLE];
+    struct runi_object *ring = memo->items[MEMO_RING];
+    struct runi_handler handler;
+    if (setjmp(handler.buf)) {
+        char msg[sizeof(ctx->error)];
+        snprintf(msg, sizeof(msg), "%s", ctx->error);
+        unlock(ctx, memo);
+        runi_error(ctx, "%s", msg);
+    }
+    lock(ctx, memo);
+    runi_push_handler(ctx, &handler);
+    struct runi_object *old = runi_hashtable_get(table, node->items[NODE_KEY]);
+    if (old)
+        unlink_node(old);
+    runi_hashtable_put(ctx, table, node->items[NODE_KEY], node);
+    push_front(ring, node);
+    if (table->hcount > (size_t)runi_fixnum_value(memo->items[MEMO_LIMIT])) {
+        struct runi_object *oldest = ring->items[NODE_PREV];
+        unlink_node(oldest);
+        runi_hashtable_remove(table, oldest->items[NODE_KEY]);
+    }
+    runi_pop_handler(ctx, &handler);
+    unlock(ctx, memo);
+}
+
+struct runi_object *runi_memo_call(struct runi_context *ctx, struct runi_object *fn, struct runi_object *frame) {
+    struct runi_object *key = runi_nil;
+    for (size_t i = frame->nslots; i > 0; i--)
+        key = runi_cons(ctx, frame->slots[i - 1], key);
+    struct runi_object *node = lookup(ctx, fn->memo, key);
+    if (node)
+        return node->items[NODE_VALUE];
+    struct runi_object *value = runi_invoke(ctx, fn, frame);
+    node = runi_make_vector(ctx, NODE_SIZE, runi_nil);
+    node->items[NODE_KEY] = key;
+    node->items[NODE_VALUE] = value;
+    store(ctx, fn->memo, node);
+    return value;
+}
+
+struct runi_object *runi_hcons(struct runi_context *ctx, struct runi_object *car, struct runi_object *cdr) {
+    if (!ctx->hcons)
+        ctx->hcons = runi_make_hashtable(ctx, RUNI_HASH_CONS);
+    struct runi_object probe = { .type = RUNI_LIST, .car = car, .cdr = cdr };
+    struct runi_object *shared = runi_hashtable_get(ctx->hcons, &probe);
+    if (shared)
+        return shared;
+    struct runi_object *cell = runi_cons(ctx, car, cdr);
+    runi_hashtable_put(ctx, ctx->hcons, cell, cell);
+    return cell;
+}
@@ -0,0 +1,374 @@
+#include "runi_lisp.h"
+
+#include <unistd.h>
+
+#define RUNI_PAR_CHUNKS_PER_THREAD 8
+
+struct runi_par_deque {
+    pthread_mutex_t lock;
+    size_t top;
+    size_t bottom;
+};
+
+struct runi_par_job {
+    struct runi_context *ctx;
+    struct runi_object *env;
+    struct runi_object *fn;
+    struct runi_object *items;
+    struct runi_object *results;
+    bool reduce;
+    size_t chunk_size;
+    int nworkers;
+    struct runi_par_deque *deques;
+    struct runi_par_worker *workers;
+    struct runi_context **contexts;
+    pthread_mutex_t gc_lock;
+    pthread_cond_t gc_cond;
+    int stopped;
+    int finished;
+    bool gc_pending;
+    unsigned long gc_epoch;
+    pthread_mutex_t error_lock;
+    bool failed;
+    char error[256];
+};
+
+struct runi_par_worker {
+    struct runi_par_job *job;
+    struct runi_context *ctx;
+    int id;
+};
+
+struct runi_par_thread {
+    struct runi_par_pool *pool;
+    int id;
+    pthread_t thread;
+};
+
+struct runi_par_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+    struct runi_par_thread **threads;
+    int nthreads;
+    int busy;
+    unsigned long generation;
+    struct runi_par_job *job;
+    bool quit;
+};
+
+static bool failed(struct runi_par_job *job) {
+    return __atomic_load_n(&job->failed, __ATOMIC_RELAXED);
+}
+
+static bool take(struct runi_par_job *job, int id, size_t *chunk) {
+    struct runi_par_deque *d = &job->deques[id];
+    pthread_mutex_lock(&d->lock);
+    bool found = d->top < d->bottom;
+    if (found)
+        *chunk = --d->bottom;
+    pthread_mutex_unlock(&d->lock);
+    for (int i = 1; !found && i < job->nworkers; i++) {
+        d = &job->deques[(id + i) % job->nworkers];
+        pthread_mutex_lock(&d->lock);
+        found = d->top < d->bottom;
+        if (found)
+            *chunk = d->top++;
+        pthread_mutex_unlock(&d->lock);
+    }
+    return found;
+}
+
+static void run_chunk(struct runi_par_worker *w, size_t chunk) {
+    struct runi_par_job *job = w->job;
+    size_t start = chunk * job->chunk_size;
+    size_t end = start + job->chunk_size;
+    if (end > job->items->nitems)
+        end = job->items->nitems;
+    if (!job->reduce) {
+        for (size_t i = start; i < end; i++)
+            job->results->items[i] = runi_funcall(w->ctx, job->env, job->fn, 1, &job->items->items[i]);
+        return;
+    }
+    struct runi_object *acc = job->items->items[start];
+    for (size_t i = start + 1; i < end; i++) {
+        struct runi_object *argv[2] = { acc, job->items->items[i] };
+        acc = runi_funcall(w->ctx, job->env, job->fn, 2, argv);
+    }
+    job->results->items[chunk] = acc;
+}
+
+static void collect(struct runi_par_job *job) {
+    if (job->stopped < job->nworkers || !job->gc_pending)
+        return;
+    runi_gc_collect_children(job->ctx, job->contexts, job->nworkers);
+    job->gc_pending = false;
+    job->gc_epoch++;
+    pthread_cond_broadcast(&job->gc_cond);
+}
+
+void runi_par_safepoint(struct runi_context *ctx) {
+    struct runi_par_job *job = ctx->job;
+    if (!job)
+        return;
+    jmp_buf regs;
+    setjmp(regs);
+    runi_gc_stack_top(ctx);
+    ctx->stack_low = &regs;
+    pthread_mutex_lock(&job->gc_lock);
+    unsigned long epoch = job->gc_epoch;
+    job->gc_pending = true;
+    job->stopped++;
+    collect(job);
+    while (job->gc_epoch == epoch)
+        pthread_cond_wait(&job->gc_cond, &job->gc_lock);
+    job->stopped--;
+    pthread_mutex_unlock(&job->gc_lock);
+}
+
+void runi_par_lock(struct runi_context *ctx, pthread_mutex_t *lock) {
+    struct runi_par_job *job = ctx->job;
+    if (!job || pthread_mutex_trylock(lock) == 0) {
+        if (!job)
+            pthread_mutex_lock(lock);
+        return;
+    }
+    jmp_buf regs;
+    setjmp(regs);
+    runi_gc_stack_top(ctx);
+    ctx->stack_low = &regs;
+    pthread_mutex_lock(&job->gc_lock);
+    job->stopped++;
+    collect(job);
+    pthread_mutex_unlock(&job->gc_lock);
+    pthread_mutex_lock(lock);
+    pthread_mutex_lock(&job->gc_lock);
+    while (job->gc_pending)
+        pthread_cond_wait(&job->gc_cond, &job->gc_lock);
+    job->stopped--;
+    pthread_mutex_unlock(&job->gc_lock);
+}
+
+static void finish(struct runi_par_job *job, struct runi_context *ctx) {
+    jmp_buf regs;
+    setjmp(regs);
+    runi_gc_stack_top(ctx);
+    ctx->stack_low = &regs;
+    pthread_mutex_lock(&job->gc_lock);
+    job->stopped++;
+    job->finished++;
+    collect(job);
+    if (job->finished == job->nworkers)
+        pthread_cond_broadcast(&job->gc_cond);
+    while (job->finished < job->nworkers)
+        pthread_cond_wait(&job->gc_cond, &job->gc_lock);
+    pthread_mutex_unlock(&job->gc_lock);
+}
+
+static void *work(void *arg) {
+    struct runi_par_worker *w = arg;
+    struct runi_par_job *job = w->job;
+    struct runi_handler handler;
+    if (setjmp(handler.buf)) {
+        pthread_mutex_lock(&job->error_lock);
+        if (!job->failed) {
+            snprintf(job->error, sizeof(job->error), "%s", w->ctx->error);
+            __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&job->error_lock);
+        finish(job, w->ctx);
+        return NULL;
+    }
+    runi_push_handler(w->ctx, &handler);
+    size_t chunk;
+    while (!failed(job) && take(job, w->id, &chunk))
+        run_chunk(w, chunk);
+    runi_pop_handler(w->ctx, &handler);
+    finish(job, w->ctx);
+    return NULL;
+}
+
+static void *pool_thread(void *arg) {
+    struct runi_par_thread *t = arg;
+    struct runi_par_pool *pool = t->pool;
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->quit && pool->generation == seen)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->quit)
+            break;
+        seen = pool->generation;
+        struct runi_par_job *job = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+        if (t->id < job->nworkers)
+            work(&job->workers[t->id]);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->idle);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static struct runi_par_pool *pool_get(struct runi_context *ctx, int nthreads) {
+    struct runi_par_pool *pool = ctx->pool;
+    if (!pool) {
+        pool = calloc(1, sizeof(*pool));
+        if (!pool)
+            return NULL;
+        pthread_mutex_init(&pool->lock, NULL);
+        pthread_cond_init(&pool->wake, NULL);
+        pthread_cond_init(&pool->idle, NULL);
+        ctx->pool = pool;
+    }
+    if (pool->nthreads >= nthreads)
+        return pool;
+    struct runi_par_thread **threads = realloc(pool->threads, sizeof(*threads) * nthreads);
+    if (!threads)
+        return pool;
+    pool->threads = threads;
+    while (pool->nthreads < nthreads) {
+        struct runi_par_thread *t = malloc(sizeof(*t));
+        if (!t)
+            break;
+        t->pool = pool;
+        t->id = pool->nthreads + 1;
+        if (pthread_create(&t->thread, NULL, pool_thread, t) != 0) {
+            free(t);
+            break;
+        }
+        threads[pool->nthreads++] = t;
+    }
+    return pool;
+}
+
+void runi_par_pool_free(struct runi_context *ctx) {
+    struct runi_par_pool *pool = ctx->pool;
+    if (!pool)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->nthreads; i++) {
+        pthread_join(pool->threads[i]->thread, NULL);
+        free(pool->threads[i]);
+    }
+    pthread_cond_destroy(&pool->idle);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+    ctx->pool = NULL;
+}
+
+static int worker_count(struct runi_context *ctx, size_t nitems) {
+    if (ctx->parent)
+        return 1;
+    long n = ctx->nthreads > 0 ? ctx->nthreads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1)
+        n = 1;
+    if ((size_t)n > nitems)
+        n = nitems;
+    return n;
+}
+
+static void run_job(struct runi_context *ctx, struct runi_par_job *job) {
+    struct runi_par_pool *pool = pool_get(ctx, job->nworkers - 1);
+    if (!pool)
+        runi_error(ctx, "Memory exhausted");
+    if (job->nworkers > pool->nthreads + 1)
+        job->nworkers = pool->nthreads + 1;
+    int n = job->nworkers;
+    size_t nchunks = (job->items->nitems + job->chunk_size - 1) / job->chunk_size;
+    struct runi_par_worker *workers = calloc(n, sizeof(*workers));
+    job->deques = calloc(n, sizeof(*job->deques));
+    job->contexts = calloc(n, sizeof(*job->contexts));
+    if (!workers || !job->deques || !job->contexts) {
+        free(workers);
+        free(job->deques);
+        free(job->contexts);
+        runi_error(ctx, "Memory exhausted");
+    }
+    job->ctx = ctx;
+    job->workers = workers;
+    pthread_mutex_init(&job->gc_lock, NULL);
+    pthread_cond_init(&job->gc_cond, NULL);
+    pthread_mutex_init(&job->error_lock, NULL);
+    for (int i = 0; i < n; i++) {
+        pthread_mutex_init(&job->deques[i].lock, NULL);
+        job->deques[i].top = nchunks * i / n;
+        job->deques[i].bottom = nchunks * (i + 1) / n;
+        workers[i].job = job;
+        workers[i].id = i;
+        workers[i].ctx = job->contexts[i] = runi_context_new_child(ctx);
+        if (!workers[i].ctx) {
+            snprintf(job->error, sizeof(job->error), "Memory exhausted");
+            job->failed = true;
+        } else {
+            workers[i].ctx->job = job;
+        }
+    }
+    if (!job->failed) {
+        pthread_mutex_lock(&pool->lock);
+        pool->job = job;
+        pool->busy = pool->nthreads;
+        pool->generation++;
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+        work(&workers[0]);
+        pthread_mutex_lock(&pool->lock);
+        while (pool->busy)
+            pthread_cond_wait(&pool->idle, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    for (int i = 0; i < n; i++) {
+        if (workers[i].ctx)
+            runi_context_join(ctx, workers[i].ctx);
+        pthread_mutex_destroy(&job->deques[i].lock);
+    }
+    pthread_mutex_destroy(&job->error_lock);
+    pthread_cond_destroy(&job->gc_cond);
+    pthread_mutex_destroy(&job->gc_lock);
+    free(workers);
+    free(job->deques);
+    free(job->contexts);
+    if (job->failed)
+        runi_error(ctx, "%s", job->error);
+}
+
+struct runi_object *runi_parallel_map(struct runi_context *ctx, struct runi_object *env, struct runi_object *fn, struct runi_object *items) {
+    struct runi_par_job job = { .env = env, .fn = fn, .items = items };
+    job.results = runi_make_vector(ctx, items->nitems, runi_nil);
+    job.nworkers = worker_count(ctx, items->nitems);
+    if (job.nworkers <= 1) {
+        for (size_t i = 0; i < items->nitems; i++)
+            job.results->items[i] = runi_funcall(ctx, env, fn, 1, &items->items[i]);
+        return job.results;
+    }
+    job.chunk_size = (items->nitems + job.nworkers * RUNI_PAR_CHUNKS_PER_THREAD - 1) / (job.nworkers * RUNI_PAR_CHUNKS_PER_THREAD);
+    run_job(ctx, &job);
+    return job.results;
+}
+
+struct runi_object *runi_parallel_reduce(struct runi_context *ctx, struct runi_object *env, struct runi_object *fn, struct runi_object *init, struct runi_object *items) {
+    struct runi_par_job job = { .env = env, .fn = fn, .items = items, .reduce = true };
+    job.nworkers = worker_count(ctx, items->nitems);
+    struct runi_object *acc = init;
+    if (job.nworkers <= 1) {
+        for (size_t i = 0; i < items->nitems; i++) {
+            struct runi_object *argv[2] = { acc, items->items[i] };
+            acc = runi_funcall(ctx, env, fn, 2, argv);
+        }
+        return acc;
+    }
+    job.chunk_size = (items->nitems + job.nworkers * RUNI_PAR_CHUNKS_PER_THREAD - 1) / (job.nworkers * RUNI_PAR_CHUNKS_PER_THREAD);
+    job.results = runi_make_vector(ctx, (items->nitems + job.chunk_size - 1) / job.chunk_size, runi_nil);
+    run_job(ctx, &job);
+    for (size_t i = 0; i < job.results->nitems; i++) {
+        struct runi_object *argv[2] = { acc, job.results->items[i] };
+        acc = runi_funcall(ctx, env, fn, 2, argv);
+    }
+    return acc;
+}
@@ -0,0 +1,124 @@
+#include "runi_lisp.h"
+
+#include <signal.h>
+#include <sys/time.h>
+
+#define RUNI_PROF_BUFFER_WORDS (4 * 1024 * 1024)
+
+static struct runi_context *prof_ctx;
+static pthread_t prof_thread;
+static uintptr_t *prof_samples;
+static volatile size_t prof_nwords;
+static struct sigaction prof_old_action;
+
+static void prof_handler(int sig) {
+    (void)sig;
+    struct runi_context *ctx = prof_ctx;
+    if (!ctx || !pthread_equal(pthread_self(), prof_thread))
+        return;
+    size_t depth = ctx->prof_len;
+    if (depth > RUNI_PROF_MAX_DEPTH)
+        depth = RUNI_PROF_MAX_DEPTH;
+    size_t n = prof_nwords;
+    if (n + depth + 1 > RUNI_PROF_BUFFER_WORDS)
+        return;
+    prof_samples[n] = depth;
+    for (size_t i = 0; i < depth; i++)
+        prof_samples[n + 1 + i] = (uintptr_t)ctx->prof_stack[i];
+    prof_nwords = n + depth + 1;
+}
+
+void runi_profile_start(struct runi_context *ctx) {
+    if (prof_ctx)
+        runi_error(ctx, "profile-start: profiler is already running");
+    prof_samples = malloc(sizeof(*prof_samples) * RUNI_PROF_BUFFER_WORDS);
+    if (!prof_samples)
+        runi_error(ctx, "Memory exhausted");
+    prof_nwords = 0;
+    prof_thread = pthread_self();
+    prof_ctx = ctx;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = prof_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, &prof_old_action);
+    struct itimerval timer = { { 0, RUNI_PROF_INTERVAL_US }, { 0, RUNI_PROF_INTERVAL_US } };
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+struct prof_stack {
+    char *folded;
+};
+
+static int prof_stack_compare(const void *a, const void *b) {
+    return strcmp(((const struct prof_stack *)a)->folded, ((const struct prof_stack *)b)->folded);
+}
+
+static char *prof_fold(const uintptr_t *frames, size_t depth) {
+    size_t len = 0;
+    for (size_t i = 0; i < depth; i++) {
+        struct runi_object *name = (struct runi_object *)frames[i];
+        len += (name ? strlen(name->name) : strlen("lambda")) + 1;
+    }
+    char *s = malloc(len ? len : sizeof("<toplevel>"));
+    if (!s)
+        return NULL;
+    if (depth == 0) {
+        strcpy(s, "<toplevel>");
+        return s;
+    }
+    char *p = s;
+    for (size_t i = 0; i < depth; i++) {
+        struct runi_object *name = (struct runi_object *)frames[i];
+        const char *n = name ? name->name : "lambda";
+        size_t l = strlen(n);
+        memcpy(p, n, l);
+        p += l;
+        *p++ = i + 1 < depth ? ';' : '\0';
+    }
+    return s;
+}
+
+long runi_profile_stop(struct runi_context *ctx, const char *path) {
+    if (prof_ctx != ctx)
+        runi_error(ctx, "profile-stop: profiler is not running");
+    struct itimerval timer = { { 0, 0 }, { 0, 0 } };
+    setitimer(ITIMER_PROF, &timer, NULL);
+    sigaction(SIGPROF, &prof_old_action, NULL);
+    prof_ctx = NULL;
+
+    size_t nsamples = 0;
+    for (size_t i = 0; i < prof_nwords; i += prof_samples[i] + 1)
+        nsamples++;
+    struct prof_stack *stacks = calloc(nsamples ? nsamples : 1, sizeof(*stacks));
+    bool ok = stacks != NULL;
+    size_t n = 0;
+    for (size_t i = 0; ok && i < prof_nwords; i += prof_samples[i] + 1, n++)
+        ok = (stacks[n].folded = prof_fold(&prof_samples[i + 1], prof_samples[i])) != NULL;
+    free(prof_samples);
+    prof_samples = NULL;
+
+    FILE *fp = NULL;
+    if (ok) {
+        qsort(stacks, nsamples, sizeof(*stacks), prof_stack_compare);
+        fp = fopen(path, "w");
+        ok = fp != NULL;
+    }
+    for (size_t i = 0; ok && i < nsamples; ) {
+        size_t j = i + 1;
+        while (j < nsamples && strcmp(stacks[i].folded, stacks[j].folded) == 0)
+            j++;
+        ok = fprintf(fp, "%s %zu\n", stacks[i].folded, j - i) >= 0;
+        i = j;
+    }
+    if (fp && fclose(fp) != 0)
+        ok = false;
+    for (size_t i = 0; stacks && i < nsamples; i++)
+        free(stacks[i].folded);
+    free(stacks);
+    if (!ok)
+        runi_error(ctx, "profile-stop: cannot write %s", path);
+    return nsamples;
+}
@@ -0,0 +1,701 @@
+#include "runi_lisp.h"
+
+#define RUNI_VM_MAX_STACK 256
+
+struct runi_compiler {
+    struct runi_context *ctx;
+    int32_t *ops;
+    int nops;
+    int capops;
+    struct runi_object **consts;
+    int nconsts;
+    int capconsts;
+    int depth;
+    int maxdepth;
+    bool failed;
+};
+
+static void emit(struct runi_compiler *c, int32_t op) {
+    if (c->nops == c->capops) {
+        c->capops = c->capops ? c->capops * 2 : 64;
+        c->ops = realloc(c->ops, sizeof(*c->ops) * c->capops);
+        if (!c->ops)
+            runi_error(c->ctx, "Memory exhausted");
+    }
+    c->ops[c->nops++] = op;
+}
+
+static int add_const(struct runi_compiler *c, struct runi_object *obj) {
+    for (int i = 0; i < c->nconsts; i++)
+        if (c->consts[i] == obj)
+            return i;
+    if (c->nconsts == c->capconsts) {
+        c->capconsts = c->capconsts ? c->capconsts * 2 : 16;
+        c->consts = realloc(c->consts, sizeof(*c->consts) * c->capconsts);
+        if (!c->consts)
+            runi_error(c->ctx, "Memory exhausted");
+    }
+    c->consts[c->nconsts] = obj;
+    return c->nconsts++;
+}
+
+static void adjust_depth(struct runi_compiler *c, int delta) {
+    c->depth += delta;
+    if (c->depth > c->maxdepth)
+        c->maxdepth = c->depth;
+    if (c->maxdepth > RUNI_VM_MAX_STACK)
+        c->failed = true;
+}
+
+static void emit_eval(struct runi_compiler *c, struct runi_object *form) {
+    emit(c, RUNI_OP_EVAL);
+    emit(c, add_const(c, form));
+    adjust_depth(c, 1);
+}
+
+static int emit_jump(struct runi_compiler *c, int32_t op) {
+    emit(c, op);
+    emit(c, -1);
+    return c->nops - 1;
+}
+
+static void patch(struct runi_compiler *c, int at) {
+    c->ops[at] = c->nops;
+}
+
+static bool is_self_evaluating(struct runi_object *obj) {
+    switch (runi_type(obj)) {
+    case RUNI_INTEGER:
+    case RUNI_PRIMITIVE:
+    case RUNI_FUNCTION:
+    case RUNI_NIL:
+    case RUNI_DOT:
+    case RUNI_TRUE:
+    case RUNI_STRING:
+    case RUNI_VECTOR:
+    case RUNI_HASHTABLE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static int proper_length(struct runi_object *list) {
+    int len = 0;
+    for (; runi_type(list) == RUNI_LIST; list = list->cdr)
+        len++;
+    return list == runi_nil ? len : -1;
+}
+
+static void compile_expr(struct runi_compiler *c, struct runi_object *expr, bool tail);
+
+static void compile_body(struct runi_compiler *c, struct runi_object *body, bool tail) {
+    if (body == runi_nil) {
+        emit(c, RUNI_OP_CONST);
+        emit(c, add_const(c, runi_nil));
+        adjust_depth(c, 1);
+        return;
+    }
+    for (; body->cdr != runi_nil; body = body->cdr) {
+        compile_expr(c, body->car, false);
+        emit(c, RUNI_OP_POP);
+        adjust_depth(c, -1);
+    }
+    compile_expr(c, body->car, tail);
+}
+
+static void compile_args(struct runi_compiler *c, struct runi_object *args) {
+    for (; args != runi_nil; args = args->cdr)
+        compile_expr(c, args->car, false);
+}
+
+static int emit_builtin_guard(struct runi_compiler *c, struct runi_object *form, struct runi_object *prim) {
+    emit(c, RUNI_OP_BUILTIN);
+    emit(c, add_const(c, form->car));
+    emit(c, add_const(c, prim));
+    emit(c, add_const(c, form));
+    emit(c, -1);
+    return c->nops - 1;
+}
+
+static void compile_if(struct runi_compiler *c, struct runi_object *form, struct runi_object *prim, bool tail) {
+    struct runi_object *args = form->cdr;
+    int skip = emit_builtin_guard(c, form, prim);
+    compile_expr(c, args->car, false);
+    int els = emit_jump(c, RUNI_OP_JUMPNIL);
+    adjust_depth(c, -1);
+    compile_expr(c, args->cdr->car, tail);
+    int end = emit_jump(c, RUNI_OP_JUMP);
+    adjust_depth(c, -1);
+    patch(c, els);
+    compile_body(c, args->cdr->cdr, tail);
+    patch(c, end);
+    patch(c, skip);
+}
+
+static void compile_arith(struct runi_compiler *c, struct runi_object *form, struct runi_object *prim, int32_t op, int argc) {
+    int skip = emit_builtin_guard(c, form, prim);
+    compile_args(c, form->cdr);
+    emit(c, op);
+    emit(c, argc);
+    adjust_depth(c, 1 - argc);
+    patch(c, skip);
+}
+
+static void compile_call(struct runi_compiler *c, struct runi_object *form, int argc, bool tail) {
+    int skip;
+    if (runi_type(form->car) == RUNI_GLOBALREF) {
+        emit(c, RUNI_OP_CALLEE);
+        emit(c, add_const(c, form->car));
+        emit(c, add_const(c, form));
+        emit(c, -1);
+        skip = c->nops - 1;
+        adjust_depth(c, 1);
+    } else {
+        compile_expr(c, form->car, false);
+        emit(c, RUNI_OP_CHECKFN);
+        emit(c, add_const(c, form));
+        emit(c, -1);
+        skip = c->nops - 1;
+    }
+    compile_args(c, form->cdr);
+    emit(c, tail ? RUNI_OP_TAILCALL : RUNI_OP_CALL);
+    emit(c, argc);
+    adjust_depth(c, -argc);
+    patch(c, skip);
+}
+
+static void compile_guard(struct runi_compiler *c, struct runi_object *form, bool tail) {
+    struct runi_object *args = form->cdr;
+    emit(c, RUNI_OP_GUARD);
+    emit(c, add_const(c, args->car));
+    emit(c, -1);
+    int fallback = c->nops - 1;
+    compile_expr(c, args->cdr->car, tail);
+    int end = emit_jump(c, RUNI_OP_JUMP);
+    adjust_depth(c, -1);
+    patch(c, fallback);
+    compile_expr(c, args->cdr->cdr->car, tail);
+    patch(c, end);
+}
+
+static void compile_form(struct runi_compiler *c, struct runi_object *form, bool tail) {
+    struct runi_object *head = form->car;
+    int argc = proper_length(form->cdr);
+    if (argc < 0) {
+        emit_eval(c, form);
+        return;
+    }
+
+    if (head == runi_guard_marker && argc == 3) {
+        compile_guard(c, form, tail);
+        return;
+    }
+
+    if (runi_type(head) == RUNI_SYMBOL) {
+        struct runi_object *v = head->value;
+        if (v && runi_type(v) == RUNI_PRIMITIVE && v->fn == runi_prim_quote && argc == 1) {
+            emit(c, RUNI_OP_CONST);
+            emit(c, add_const(c, form->cdr->car));
+            adjust_depth(c, 1);
+            return;
+        }
+        struct runi_object *target = argc == 2 ? form->cdr->car : NULL;
+        if (v && runi_type(v) == RUNI_PRIMITIVE && v->fn == runi_prim_setq && target && runi_type(target) == RUNI_LOCALREF) {
+            compile_expr(c, form->cdr->cdr->car, false);
+            if (target->depth == 0) {
+                emit(c, RUNI_OP_SETLOCAL);
+            } else {
+                emit(c, RUNI_OP_SETOUTER);
+                emit(c, target->depth);
+            }
+            emit(c, target->index);
+            return;
+        }
+        emit_eval(c, form);
+        return;
+    }
+
+    if (runi_type(head) == RUNI_GLOBALREF) {
+        struct runi_object *v = head->symbol->value;
+        if (v && runi_type(v) == RUNI_PRIMITIVE) {
+            if (v->fn == runi_prim_if && argc >= 2)
+                compile_if(c, form, v, tail);
+            else if (v->afn == runi_prim_plus)
+                compile_arith(c, form, v, RUNI_OP_ADD, argc);
+            else if (v->afn == runi_prim_minus && argc >= 1)
+                compile_arith(c, form, v, RUNI_OP_SUB, argc);
+            else if (v->afn == runi_prim_num_eq && argc == 2)
+                compile_arith(c, form, v, RUNI_OP_NUMEQ, argc);
+            else if (v->afn == runi_prim_lt && argc == 2)
+                compile_arith(c, form, v, RUNI_OP_LT, argc);
+            else
+                emit_eval(c, form);
+            return;
+        }
+        if (v && runi_type(v) == RUNI_MACRO) {
+            emit_eval(c, form);
+            return;
+        }
+        compile_call(c, form, argc, tail);
+        return;
+    }
+
+    if (runi_type(head) == RUNI_LOCALREF || runi_type(head) == RUNI_LIST) {
+        compile_call(c, form, argc, tail);
+        return;
+    }
+    emit_eval(c, form);
+}
+
+static void compile_expr(struct runi_compiler *c, struct runi_object *expr, bool tail) {
+    if (c->failed)
+        return;
+    switch (runi_type(expr)) {
+    case RUNI_LOCALREF:
+        if (expr->depth == 0) {
+            emit(c, RUNI_OP_LOCAL);
+        } else {
+            emit(c, RUNI_OP_OUTER);
+            emit(c, expr->depth);
+        }
+        emit(c, expr->index);
+        adjust_depth(c, 1);
+        return;
+    case RUNI_SYMBOL:
+        emit(c, RUNI_OP_GLOBAL);
+        emit(c, add_const(c, expr));
+        adjust_depth(c, 1);
+        return;
+    case RUNI_LIST:
+        compile_form(c, expr, tail);
+        return;
+    default:
+        if (!is_self_evaluating(expr)) {
+            emit_eval(c, expr);
+            return;
+        }
+        emit(c, RUNI_OP_CONST);
+        emit(c, add_const(c, expr));
+        adjust_depth(c, 1);
+    }
+}
+
+bool runi_vm_compile(struct runi_context *ctx, struct runi_object *fn) {
+    if (runi_function_body(ctx, fn) != fn->body)
+        return false;
+    struct runi_object *compiled = __atomic_load_n(&fn->code, __ATOMIC_ACQUIRE);
+    if (compiled)
+        return compiled != runi_nil;
+    struct runi_compiler c = { .ctx = ctx };
+    if (proper_length(fn->body) > 0) {
+        compile_body(&c, fn->body, true);
+        emit(&c, RUNI_OP_RET);
+    } else {
+        c.failed = true;
+    }
+    if (c.failed) {
+        compiled = runi_nil;
+    } else {
+        struct runi_object *code = runi_make_code(ctx, c.nops, c.nconsts, c.maxdepth, runi_list_length(ctx, fn->args));
+        for (int i = 0; i < c.nconsts; i++)
+            code->consts[i] = c.consts[i];
+        memcpy(runi_code_ops(code), c.ops, sizeof(*c.ops) * c.nops);
+        compiled = code;
+    }
+    free(c.ops);
+    free(c.consts);
+    struct runi_object *expected = NULL;
+    if (!__atomic_compare_exchange_n(&fn->code, &expected, compiled, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+        compiled = expected;
+    return compiled != runi_nil;
+}
+
+static void reserve(struct runi_context *ctx, size_t need) {
+    if (need <= ctx->vm_cap)
+        return;
+    size_t cap = ctx->vm_cap ? ctx->vm_cap : 4096;
+    while (cap < need)
+        cap *= 2;
+    struct runi_object **stack = calloc(cap, sizeof(*stack));
+    if (!stack)
+        runi_error(ctx, "Memory exhausted");
+    if (ctx->vm_stack)
+        memcpy(stack, ctx->vm_stack, sizeof(*stack) * ctx->vm_cap);
+    else
+        runi_gc_add_range(ctx, (void ***)&ctx->vm_stack, &ctx->vm_cap);
+    free(ctx->vm_stack);
+    ctx->vm_stack = stack;
+    ctx->vm_cap = cap;
+}
+
+static struct runi_object *materialize(struct runi_context *ctx, struct runi_object **stack, size_t bp) {
+    struct runi_object *fn = stack[bp - 2];
+    int nparams = fn->code->nparams;
+    struct runi_object *frame = runi_make_frame(ctx, fn->env, fn->args, nparams);
+    for (int i = 0; i < nparams; i++)
+        frame->slots[i] = stack[bp + i];
+    ctx->vm_stack[bp - 1] = frame;
+    return frame;
+}
+
+static struct runi_object *outer_env(struct runi_object *fn, int depth) {
+    struct runi_object *env = fn->env;
+    for (int d = depth; d > 1; d--)
+        env = env->parent;
+    return env;
+}
+
+static int64_t check_integer(struct runi_context *ctx, struct runi_object *obj, char *msg) {
+    if (!runi_is_fixnum(obj))
+        runi_error(ctx, "%s", msg);
+    return runi_fixnum_value(obj);
+}
+
+static struct runi_object *check_range(struct runi_context *ctx, int64_t n) {
+    if (n < RUNI_FIXNUM_MIN || n > RUNI_FIXNUM_MAX)
+        runi_error(ctx, "Integer overflow");
+    return runi_fixnum(n);
+}
+
+struct runi_object *runi_vm_arith(struct runi_context *ctx, int op, int argc, struct runi_object **argv) {
+    switch (op) {
+    case RUNI_OP_ADD: {
+        int64_t sum = 0;
+        for (int i = 0; i < argc; i++)
+            sum += check_integer(ctx, argv[i], "+ takes only numbers");
+        return check_range(ctx, sum);
+    }
+    case RUNI_OP_SUB: {
+        int64_t r = check_integer(ctx, argv[0], "- takes only numbers");
+        if (argc == 1)
+            r = -r;
+        for (int i = 1; i < argc; i++)
+            r -= check_integer(ctx, argv[i], "- takes only numbers");
+        return check_range(ctx, r);
+    }
+    case RUNI_OP_NUMEQ: {
+        int64_t x = check_integer(ctx, argv[0], "= only takes numbers");
+        int64_t y = check_integer(ctx, argv[1], "= only takes numbers");
+        return x == y ? runi_true : runi_nil;
+    }
+    case RUNI_OP_LT: {
+        int64_t x = check_integer(ctx, argv[0], "< only takes numbers");
+        int64_t y = check_integer(ctx, argv[1], "< only takes numbers");
+        return x < y ? runi_true : runi_nil;
+    }
+    default:
+        runi_error(ctx, "Bug: vm: Unknown arithmetic opcode: %d", op);
+    }
+}
+
+struct runi_object *runi_vm_execute(struct runi_context *ctx, struct runi_object *fn, struct runi_object *frame) {
+    if (ctx->eval_depth >= ctx->max_eval_depth)
+        runi_error(ctx, "Recursion too deep: evaluation depth exceeds %d", ctx->max_eval_depth);
+    ctx->eval_depth++;
+
+    size_t base = ctx->vm_top;
+    int nparams = fn->code->nparams;
+    reserve(ctx, base + 2 + nparams + fn->code->nstack);
+    struct runi_object **stack = ctx->vm_stack;
+    stack[base] = fn;
+    stack[base + 1] = frame;
+    for (int i = 0; i < nparams; i++)
+        stack[base + 2 + i] = frame->slots[i];
+    size_t bp = base + 2;
+    size_t sp = bp + nparams;
+
+    size_t callbase = ctx->vm_ncalls;
+
+    struct runi_object *current = fn->code;
+    struct runi_object **consts = current->consts;
+    int32_t *ops = runi_code_ops(current);
+    int pc = 0;
+
+    static void *const dispatch[] = {
+        [RUNI_OP_CONST] = &&op_const,
+        [RUNI_OP_LOCAL] = &&op_local,
+        [RUNI_OP_OUTER] = &&op_outer,
+        [RUNI_OP_SETLOCAL] = &&op_setlocal,
+        [RUNI_OP_SETOUTER] = &&op_setouter,
+        [RUNI_OP_GLOBAL] = &&op_global,
+        [RUNI_OP_EVAL] = &&op_eval,
+        [RUNI_OP_CALLEE] = &&op_callee,
+        [RUNI_OP_CHECKFN] = &&op_checkfn,
+        [RUNI_OP_BUILTIN] = &&op_builtin,
+        [RUNI_OP_GUARD] = &&op_guard,
+        [RUNI_OP_CALL] = &&op_call,
+        [RUNI_OP_TAILCALL] = &&op_tailcall,
+        [RUNI_OP_ADD] = &&op_add,
+        [RUNI_OP_SUB] = &&op_sub,
+        [RUNI_OP_NUMEQ] = &&op_numeq,
+        [RUNI_OP_LT] = &&op_lt,
+        [RUNI_OP_JUMP] = &&op_jump,
+        [RUNI_OP_JUMPNIL] = &&op_jumpnil,
+        [RUNI_OP_POP] = &&op_pop,
+        [RUNI_OP_RET] = &&op_ret,
+    };
+
+#define CALLOUT(expr) (ctx->vm_top = sp, frame = (expr), stack = ctx->vm_stack, frame)
+#define FRAME() (stack[bp - 1] != runi_nil ? stack[bp - 1] : materialize(ctx, stack, bp))
+#define GLOBALREF(ref) (__atomic_load_n(&(ref)->epoch, __ATOMIC_ACQUIRE) == ctx->global_epoch ? __atomic_load_n(&(ref)->cache, __ATOMIC_RELAXED) : runi_eval_globalref(ctx, stack[bp - 2]->env, (ref)))
+#define NEXT() goto *dispatch[ops[pc++]]
+
+    NEXT();
+    op_const:
+        stack[sp++] = consts[ops[pc++]];
+        NEXT();
+    op_local: {
+        struct runi_object *f = stack[bp - 1];
+        int i = ops[pc++];
+        stack[sp++] = f == runi_nil ? stack[bp + i] : f->slots[i];
+        NEXT();
+    }
+    op_outer: {
+        struct runi_object *env = outer_env(stack[bp - 2], ops[pc++]);
+        stack[sp++] = env->slots[ops[pc++]];
+        NEXT();
+    }
+    op_setlocal: {
+        struct runi_object *f = stack[bp - 1];
+        int i = ops[pc++];
+        if (f == runi_nil)
+            stack[bp + i] = stack[sp - 1];
+        else
+            f->slots[i] = stack[sp - 1];
+        NEXT();
+    }
+    op_setouter: {
+        struct runi_object *env = outer_env(stack[bp - 2], ops[pc++]);
+        env->slots[ops[pc++]] = stack[sp - 1];
+        NEXT();
+    }
+    op_global: {
+        struct runi_object *sym = consts[ops[pc++]];
+        struct runi_object *env = stack[bp - 1] != runi_nil ? stack[bp - 1] : stack[bp - 2]->env;
+        struct runi_object **slot = runi_find(ctx, env, sym);
+        if (!slot)
+            runi_error(ctx, "Undefined symbol: %s", sym->name);
+        stack[sp++] = *slot;
+        NEXT();
+    }
+    op_eval: {
+        struct runi_object *form = consts[ops[pc++]];
+        struct runi_object *env = FRAME();
+        struct runi_object *r = CALLOUT(runi_eval(ctx, env, form));
+        stack[sp++] = r;
+        NEXT();
+    }
+    op_callee: {
+        struct runi_object *callee = GLOBALREF(consts[ops[pc]]);
+        if (runi_type(callee) == RUNI_FUNCTION) {
+            stack[sp++] = callee;
+            pc += 3;
+            NEXT();
+        }
+        struct runi_object *form = consts[ops[pc + 1]];
+        struct runi_object *env = FRAME();
+        struct runi_object *r = CALLOUT(runi_apply(ctx, env, callee, form->cdr));
+        stack[sp++] = r;
+        pc = ops[pc + 2];
+        NEXT();
+    }
+    op_checkfn: {
+        struct runi_object *callee = stack[sp - 1];
+        if (runi_type(callee) == RUNI_FUNCTION) {
+            pc += 2;
+            NEXT();
+        }
+        struct runi_object *form = consts[ops[pc]];
+        struct runi_object *env = FRAME();
+        struct runi_object *r = CALLOUT(runi_apply(ctx, env, callee, form->cdr));
+        stack[sp - 1] = r;
+        pc = ops[pc + 1];
+        NEXT();
+    }
+    op_builtin: {
+        struct runi_object *callee = GLOBALREF(consts[ops[pc]]);
+        if (callee == consts[ops[pc + 1]]) {
+            pc += 4;
+            NEXT();
+        }
+        struct runi_object *form = consts[ops[pc + 2]];
+        struct runi_object *env = FRAME();
+        struct runi_object *r = CALLOUT(runi_apply(ctx, env, callee, form->cdr));
+        stack[sp++] = r;
+        pc = ops[pc + 3];
+        NEXT();
+    }
+    op_guard: {
+        struct runi_object *p = consts[ops[pc]];
+        while (p != runi_nil && p->car->car->value == p->car->cdr)
+            p = p->cdr;
+        pc = p == runi_nil ? pc + 2 : ops[pc + 1];
+        NEXT();
+    }
+    op_call:
+    op_tailcall: {
+        bool tail = ops[pc - 1] == RUNI_OP_TAILCALL;
+        int argc = ops[pc++];
+        size_t callee_at = sp - argc - 1;
+        struct runi_object *callee = stack[callee_at];
+        if (ctx->jit_enabled && runi_jit_ready(ctx, callee) && callee->code->nparams == argc) {
+            struct runi_object *r = CALLOUT(runi_jit_enter(ctx, callee, &stack[callee_at + 1]));
+            if (r) {
+                sp = callee_at;
+                stack[sp++] = r;
+                NEXT();
+            }
+            argc = ctx->jit_tail_argc;
+            reserve(ctx, callee_at + 1 + argc);
+            stack = ctx->vm_stack;
+            callee = stack[callee_at] = ctx->jit_tail_fn;
+            memcpy(&stack[callee_at + 1], ctx->jit_tail_args, sizeof(*stack) * argc);
+            sp = callee_at + 1 + argc;
+            ctx->vm_top = sp;
+        }
+        if (callee->memo) {
+            struct runi_object *r = CALLOUT(runi_funcall(ctx, runi_nil, callee, argc, &stack[callee_at + 1]));
+            sp = callee_at;
+            stack[sp++] = r;
+            NEXT();
+        }
+        struct runi_object *code = callee->code;
+        if (!code || code == runi_nil || (callee->source && callee->depoch != ctx->global_epoch)) {
+            if (!runi_vm_compile(ctx, callee)) {
+                if (runi_list_length(ctx, callee->args) != argc)
+                    runi_error(ctx, "Cannot apply function: number of argument does not match");
+                struct runi_object *f = runi_make_frame(ctx, callee->env, callee->args, argc);
+                for (int i = 0; i < argc; i++)
+                    f->slots[i] = stack[callee_at + 1 + i];
+                size_t prof_len = ctx->prof_len;
+                runi_prof_push(ctx, callee);
+                struct runi_object *r = CALLOUT(runi_progn(ctx, f, runi_function_body(ctx, callee)));
+                ctx->prof_len = prof_len;
+                sp = callee_at;
+                stack[sp++] = r;
+                NEXT();
+            }
+            code = callee->code;
+        }
+        if (code->nparams != argc)
+            runi_error(ctx, "Cannot apply function: number of argument does not match");
+        if (tail) {
+            ctx->prof_len--;
+            runi_prof_push(ctx, callee);
+            stack[bp - 2] = callee;
+            stack[bp - 1] = runi_nil;
+            memmove(&stack[bp], &stack[callee_at + 1], sizeof(*stack) * argc);
+        } else {
+            if (ctx->eval_depth >= ctx->max_eval_depth)
+                runi_error(ctx, "Recursion too deep: evaluation depth exceeds %d", ctx->max_eval_depth);
+            ctx->eval_depth++;
+            if (ctx->vm_ncalls == ctx->vm_capcalls) {
+                ctx->vm_capcalls = ctx->vm_capcalls ? ctx->vm_capcalls * 2 : 64;
+                ctx->vm_calls = realloc(ctx->vm_calls, sizeof(*ctx->vm_calls) * ctx->vm_capcalls);
+                if (!ctx->vm_calls)
+                    runi_error(ctx, "Memory exhausted");
+            }
+            struct runi_vm_call *call = &ctx->vm_calls[ctx->vm_ncalls++];
+            call->code = current;
+            call->ops = ops;
+            call->pc = pc;
+            call->bp = bp;
+            for (int i = argc; i > 0; i--)
+                stack[callee_at + 1 + i] = stack[callee_at + i];
+            stack[callee_at + 1] = runi_nil;
+            bp = callee_at + 2;
+            runi_prof_push(ctx, callee);
+        }
+        sp = bp + argc;
+        ctx->vm_top = sp;
+        if (sp + code->nstack > ctx->vm_cap) {
+            reserve(ctx, sp + code->nstack);
+            stack = ctx->vm_stack;
+        }
+        current = code;
+        consts = code->consts;
+        ops = runi_code_ops(code);
+        pc = 0;
+        NEXT();
+    }
+    op_add: {
+        int argc = ops[pc++];
+        int64_t sum = 0;
+        sp -= argc;
+        for (int i = 0; i < argc; i++)
+            sum += check_integer(ctx, stack[sp + i], "+ takes only numbers");
+        stack[sp++] = check_range(ctx, sum);
+        NEXT();
+    }
+    op_sub: {
+        int argc = ops[pc++];
+        sp -= argc;
+        int64_t r = check_integer(ctx, stack[sp], "- takes only numbers");
+        if (argc == 1)
+            r = -r;
+        for (int i = 1; i < argc; i++)
+            r -= check_integer(ctx, stack[sp + i], "- takes only numbers");
+        stack[sp++] = check_range(ctx, r);
+        NEXT();
+    }
+    op_numeq: {
+        pc++;
+        sp -= 2;
+        int64_t x = check_integer(ctx, stack[sp], "= only takes numbers");
+        int64_t y = check_integer(ctx, stack[sp + 1], "= only takes numbers");
+        if (ops[pc] == RUNI_OP_JUMPNIL) {
+            pc = x == y ? pc + 2 : ops[pc + 1];
+            NEXT();
+        }
+        stack[sp++] = x == y ? runi_true : runi_nil;
+        NEXT();
+    }
+    op_lt: {
+        pc++;
+        sp -= 2;
+        int64_t x = check_integer(ctx, stack[sp], "< only takes numbers");
+        int64_t y = check_integer(ctx, stack[sp + 1], "< only takes numbers");
+        if (ops[pc] == RUNI_OP_JUMPNIL) {
+            pc = x < y ? pc + 2 : ops[pc + 1];
+            NEXT();
+        }
+        stack[sp++] = x < y ? runi_true : runi_nil;
+        NEXT();
+    }
+    op_jump:
+        pc = ops[pc];
+        NEXT();
+    op_jumpnil:
+        if (stack[--sp] == runi_nil)
+            pc = ops[pc];
+        else
+            pc++;
+        NEXT();
+    op_pop:
+        sp--;
+        NEXT();
+    op_ret: {
+        struct runi_object *r = stack[sp - 1];
+        ctx->eval_depth--;
+        if (ctx->vm_ncalls == callbase) {
+            ctx->vm_top = base;
+            return r;
+        }
+        sp = bp - 2;
+        stack[sp++] = r;
+        ctx->prof_len--;
+        struct runi_vm_call *call = &ctx->vm_calls[--ctx->vm_ncalls];
+        current = call->code;
+        consts = current->consts;
+        ops = call->ops;
+        pc = call->pc;
+        bp = call->bp;
+        ctx->vm_top = sp;
+        NEXT();
+    }
+#undef CALLOUT
+#undef FRAME
+#undef GLOBALREF
+#undef NEXT
+}